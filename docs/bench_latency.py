@@ -0,0 +1,285 @@
+"""
+Run the latency benchmark matrix of rt_test and compare it against a baseline
+
+Every case (cycle time x background load x wait mode) is run with the JSON
+summary of rt_test, and the results are stored in a directory. A directory
+of an earlier run is a baseline: the wakeup latency histogram of every case
+is compared against it with a two-sample Kolmogorov-Smirnov test, and a
+shift to higher latencies with a worse p99 or max is flagged as a regression.
+
+Usage:
+    python docs/bench_latency.py run [--out DIR] [--baseline DIR] ...
+    python docs/bench_latency.py compare BASELINE CURRENT
+"""
+
+from __future__ import print_function
+
+import argparse
+import json
+import math
+import multiprocessing
+import os
+import subprocess
+import sys
+
+# The matrix of the benchmark
+CYCLE_TIMES = ['100us', '1ms', '10ms']
+LOADS = ['idle', 'cpu', 'fp', 'memcpy', 'chase', 'mmap']
+WAIT_MODES = ['sleep', 'spin', 'hybrid']
+
+# The index of the cases of a results directory
+INDEX_FILE = 'bench.json'
+
+# The critical value of the KS test at a significance level of 0.01
+KS_CRITICAL = 1.628
+
+def case_name(cycle_time, load, wait_mode):
+    """
+    Get the name of a case of the matrix
+
+    Args:
+        cycle_time (str): the cycle time, as given to rt_test
+        load (str): the background load, or idle
+        wait_mode (str): the wait mode
+
+    Returns:
+        str: the name, which is also the name of its results file
+    """
+
+    return '%s_%s_%s' % (cycle_time, load, wait_mode)
+
+def run_case(rt_test, out_dir, cycle_time, load, wait_mode, args):
+    """
+    Run a case of the matrix, and write its JSON summary
+
+    Args:
+        rt_test (str): the path of the rt_test binary
+        out_dir (str): the results directory
+        cycle_time (str): the cycle time, as given to rt_test
+        load (str): the background load, or idle
+        wait_mode (str): the wait mode
+        args (Namespace): the options of the benchmark
+
+    Returns:
+        str: the name of the results file
+    """
+
+    name = case_name(cycle_time, load, wait_mode)
+    filename = name + '.json'
+
+    command = [rt_test, '-s', '-W', '--wait', wait_mode,
+               '--bucket-width', args.bucket_width,
+               '--json', os.path.join(out_dir, filename),
+               '-D', str(args.duration), cycle_time]
+
+    # The load runs on every CPU, next to the measurement thread
+    if load != 'idle':
+        command[1:1] = ['--load', '%s:0-%d' % (load, multiprocessing.cpu_count() - 1)]
+
+    print('# %s #' % name)
+    with open(os.devnull, 'w') as devnull:
+        subprocess.check_call(command, stdout=devnull)
+
+    return filename
+
+def run_matrix(args):
+    """
+    Run every case of the matrix, and compare against the baseline if given
+
+    Args:
+        args (Namespace): the options of the benchmark
+
+    Returns:
+        int: the exit status, 1 if any case regressed
+    """
+
+    if not os.path.isdir(args.out):
+        os.makedirs(args.out)
+
+    cases = []
+    for cycle_time in args.cycles:
+        for load in args.loads:
+            for wait_mode in args.waits:
+                cases.append({
+                    'name': case_name(cycle_time, load, wait_mode),
+                    'cycle_time': cycle_time,
+                    'load': load,
+                    'wait': wait_mode,
+                    'file': run_case(args.rt_test, args.out, cycle_time, load, wait_mode, args),
+                })
+
+    with open(os.path.join(args.out, INDEX_FILE), 'w') as f:
+        json.dump({'duration_s': args.duration, 'cases': cases}, f, indent=2)
+
+    if args.baseline is None:
+        return 0
+
+    return compare_results(args.baseline, args.out, args.tolerance)
+
+def load_results(directory):
+    """
+    Read the latency of every case of a results directory
+
+    Args:
+        directory (str): the results directory
+
+    Returns:
+        dict: the wakeup latency (of the first thread) of each case by name
+    """
+
+    with open(os.path.join(directory, INDEX_FILE)) as f:
+        index = json.load(f)
+
+    results = {}
+    for case in index['cases']:
+        with open(os.path.join(directory, case['file'])) as f:
+            summary = json.load(f)
+
+        thread = summary['threads'][0]
+        results[case['name']] = thread['wakeup'] if 'wakeup' in thread else thread['jitter']
+
+    return results
+
+def histogram_cdf(latency, num_buckets):
+    """
+    Get the cumulative distribution of a latency histogram
+
+    Args:
+        latency (dict): the latency metric of a JSON summary
+        num_buckets (int): the number of buckets (including the overflow)
+
+    Returns:
+        list: the fraction of the samples at or below each bucket
+    """
+
+    counts = [0] * num_buckets
+    for bucket, count in latency['histogram']:
+        counts[bucket] = count
+
+    total = float(max(latency['count'], 1))
+    cdf, running = [], 0
+    for count in counts:
+        running += count
+        cdf.append(running / total)
+
+    return cdf
+
+def ks_test(baseline, current):
+    """
+    Compare two latency histograms with a two-sample Kolmogorov-Smirnov test
+
+    Args:
+        baseline (dict): the latency metric of the baseline
+        current (dict): the latency metric of the current run
+
+    Returns:
+        (shifted, statistic, critical): whether the current latency is
+        significantly higher, the KS statistic and its critical value
+    """
+
+    buckets = [b for b, _ in baseline['histogram']] + [b for b, _ in current['histogram']]
+    num_buckets = max(buckets) + 1 if buckets else 1
+
+    cdf_baseline = histogram_cdf(baseline, num_buckets)
+    cdf_current = histogram_cdf(current, num_buckets)
+
+    # A higher latency puts the CDF of the current run below the baseline
+    statistic = max(b - c for b, c in zip(cdf_baseline, cdf_current))
+
+    n, m = float(max(baseline['count'], 1)), float(max(current['count'], 1))
+    critical = KS_CRITICAL * math.sqrt((n + m) / (n * m))
+
+    return statistic > critical, statistic, critical
+
+def compare_results(baseline_dir, current_dir, tolerance):
+    """
+    Compare the cases of a run against a baseline, and print a report
+
+    Args:
+        baseline_dir (str): the results directory of the baseline
+        current_dir (str): the results directory of the current run
+        tolerance (float): the relative increase of p99/max that is accepted
+
+    Returns:
+        int: the exit status, 1 if any case regressed
+    """
+
+    baseline = load_results(baseline_dir)
+    current = load_results(current_dir)
+    regressed = False
+
+    print('%-24s %12s %12s %12s %12s %8s  %s' %
+          ('Case', 'P99 [us]', 'Base P99', 'Max [us]', 'Base Max', 'KS', 'Result'))
+
+    for name in sorted(current):
+        if name not in baseline:
+            print('%-24s (not in the baseline)' % name)
+            continue
+
+        base, cur = baseline[name], current[name]
+        if base['bucket_width_ns'] != cur['bucket_width_ns']:
+            print('%-24s (different bucket widths)' % name)
+            continue
+
+        shifted, statistic, _ = ks_test(base, cur)
+
+        # A slack of one bucket, since the percentiles are bucket bounds
+        slack = cur['bucket_width_ns']
+        worse_p99 = cur['percentiles_ns']['p99'] > base['percentiles_ns']['p99'] * (1.0 + tolerance) + slack
+        worse_max = cur['max_ns'] > base['max_ns'] * (1.0 + tolerance) + slack
+
+        flags = []
+        if shifted and worse_p99:
+            flags.append('p99')
+        if worse_max:
+            flags.append('max')
+
+        regressed = regressed or (len(flags) > 0)
+
+        print('%-24s %12.2f %12.2f %12.2f %12.2f %8.4f  %s' %
+              (name, cur['percentiles_ns']['p99'] / 1e3, base['percentiles_ns']['p99'] / 1e3,
+               cur['max_ns'] / 1e3, base['max_ns'] / 1e3, statistic,
+               ('REGRESSION (%s)' % ', '.join(flags)) if flags else 'ok'))
+
+    return 1 if regressed else 0
+
+def parse_args():
+    """
+    Parse the options of the benchmark
+
+    Returns:
+        Namespace: the parsed options
+    """
+
+    parser = argparse.ArgumentParser(description='Latency benchmark of rt_test')
+    commands = parser.add_subparsers(dest='command')
+
+    run = commands.add_parser('run', help='run the matrix (and compare against a baseline)')
+    run.add_argument('--rt-test', default=os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'src', 'rt_test'))
+    run.add_argument('--out', default='bench_results', help='the results directory')
+    run.add_argument('--baseline', help='the results directory to compare against')
+    run.add_argument('--duration', type=int, default=10, help='the duration of each case in sec')
+    run.add_argument('--bucket-width', default='1us', help='the histogram bucket width')
+    run.add_argument('--tolerance', type=float, default=0.1, help='the accepted p99/max increase')
+    run.add_argument('--cycles', nargs='+', default=CYCLE_TIMES)
+    run.add_argument('--loads', nargs='+', default=LOADS)
+    run.add_argument('--waits', nargs='+', default=WAIT_MODES)
+
+    compare = commands.add_parser('compare', help='compare two results directories')
+    compare.add_argument('baseline')
+    compare.add_argument('current')
+    compare.add_argument('--tolerance', type=float, default=0.1, help='the accepted p99/max increase')
+
+    args = parser.parse_args()
+    if args.command is None:
+        parser.error('a command is required')
+
+    return args
+
+if __name__ == '__main__':
+    args = parse_args()
+
+    if args.command == 'run':
+        sys.exit(run_matrix(args))
+    else:
+        sys.exit(compare_results(args.baseline, args.current, args.tolerance))
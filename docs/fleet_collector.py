@@ -0,0 +1,470 @@
+"""
+Run rt_test on a fleet of nodes at once, and merge their latency histograms
+
+The collector starts the same rt_test run on every node (through ssh),
+at the same wall clock time (--start-at, so the clocks of the nodes should
+be synchronized by NTP or PTP). Every node sends the statistics and the
+histogram of each thread to the collector over UDP on every report
+(--report-to), and its final results at the end of the run. The histograms
+are merged per node and over the whole fleet, so that one command gives the
+percentiles of every node and of the fleet.
+
+Every snapshot holds the histogram since the start of the run, so a lost
+datagram only delays the results until the next report.
+
+Usage:
+    python docs/fleet_collector.py run --nodes board1,board2 --sudo -- -W -s -D 60 1ms
+    python docs/fleet_collector.py listen --nodes 2
+"""
+
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import select
+import socket
+import subprocess
+import time
+
+try:
+    from shlex import quote
+except ImportError:
+    from pipes import quote
+
+# The default UDP port of the collector (see src/sched_export.h)
+DEFAULT_PORT = 9870
+
+# The largest snapshot datagram
+DATAGRAM_SIZE = 65535
+
+# The percentiles of each report
+PERCENTILES = [50.0, 99.0, 99.99]
+
+# The metrics, in the order they are reported
+METRICS = ['jitter', 'wakeup', 'handoff', 'response']
+
+# How long the final results are waited for after the runs have exited (in sec)
+DONE_GRACE = 3.0
+
+class Histogram(object):
+    """
+    The latency histogram of a metric, of a thread or merged over many
+
+    The buckets are those of rt_test (the last index is the overflow, of
+    which only the max is known), so histograms of the same bucket width
+    merge exactly.
+    """
+
+    def __init__(self, bucket_width, num_buckets):
+        self.bucket_width = bucket_width
+        self.num_buckets = num_buckets
+        self.count = 0
+        self.total = 0.0
+        self.minimum = None
+        self.maximum = 0
+        self.buckets = {}
+
+    @classmethod
+    def from_snapshot(cls, latency, num_buckets):
+        """
+        Get the histogram of a snapshot
+
+        Args:
+            latency (dict): the latency object of a snapshot
+            num_buckets (int): the buckets of rt_test, past which is the overflow
+
+        Returns:
+            Histogram: the histogram
+        """
+
+        histogram = cls(latency['bucket_width_ns'], num_buckets)
+        histogram.count = latency['count']
+        histogram.total = latency['avg_ns'] * latency['count']
+        histogram.minimum = latency['min_ns'] if latency['count'] > 0 else None
+        histogram.maximum = latency['max_ns']
+        histogram.buckets = dict((index, count) for index, count in latency['histogram'])
+
+        return histogram
+
+    def merge(self, other):
+        """
+        Add the samples of another histogram
+
+        Args:
+            other (Histogram): the histogram to add, of the same bucket width
+
+        Returns:
+            bool: False if the bucket widths differ (and nothing was merged)
+        """
+
+        if other.bucket_width != self.bucket_width:
+            return False
+
+        self.count += other.count
+        self.total += other.total
+        self.maximum = max(self.maximum, other.maximum)
+        if other.minimum is not None:
+            self.minimum = other.minimum if self.minimum is None else min(self.minimum, other.minimum)
+
+        for index, count in other.buckets.items():
+            self.buckets[index] = self.buckets.get(index, 0) + count
+
+        return True
+
+    def percentile(self, percentile):
+        """
+        Get a percentile the same way rt_test does
+
+        Args:
+            percentile (float): the percentile, e.g. 99.9
+
+        Returns:
+            int: the upper bound of its bucket in nsec, or the max in the overflow
+        """
+
+        if self.count == 0:
+            return 0
+
+        rank = (percentile / 100.0) * self.count
+        target = max(1, int(rank) + (1 if int(rank) < rank else 0))
+
+        count = 0
+        for index in sorted(self.buckets):
+            if index >= self.num_buckets:
+                break
+            count += self.buckets[index]
+            if count >= target:
+                return (index + 1) * self.bucket_width
+
+        return self.maximum
+
+    def to_dict(self):
+        """
+        Get the histogram in the format of the JSON summary of rt_test
+
+        Returns:
+            dict: the count, average, min, max, percentiles and buckets
+        """
+
+        return {
+            'count': self.count,
+            'avg_ns': self.total / self.count if self.count else 0.0,
+            'min_ns': self.minimum or 0,
+            'max_ns': self.maximum,
+            'percentiles_ns': dict(('p%g' % p, self.percentile(p)) for p in PERCENTILES),
+            'bucket_width_ns': self.bucket_width,
+            'histogram': sorted(self.buckets.items()),
+        }
+
+class Collector(object):
+    """
+    The receiver of the snapshots of every node
+
+    Only the latest snapshot of each thread and metric of a node is kept,
+    since every snapshot holds the whole run so far.
+    """
+
+    def __init__(self, port, num_buckets):
+        self.num_buckets = num_buckets
+        self.socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.socket.bind(('', port))
+
+        # (address, node) -> {'threads': N, 'snapshots': {(thread, metric): snapshot}}
+        self.nodes = {}
+
+    def receive(self, timeout):
+        """
+        Receive the snapshots that arrive within a timeout
+
+        Args:
+            timeout (float): the time to wait for the first snapshot in sec
+        """
+
+        while select.select([self.socket], [], [], timeout)[0]:
+            data, address = self.socket.recvfrom(DATAGRAM_SIZE)
+            timeout = 0
+
+            try:
+                snapshot = json.loads(data.decode('utf-8'))
+                key = (address[0], snapshot['node'])
+                slot = (snapshot['thread'], snapshot['metric'])
+            except (ValueError, KeyError):
+                continue
+
+            node = self.nodes.setdefault(key, {'threads': snapshot['threads'], 'snapshots': {}})
+            last = node['snapshots'].get(slot)
+
+            # The datagrams may be reordered, and the final results are never replaced
+            if last is None or (not last['done'] and snapshot['sequence'] >= last['sequence']):
+                node['snapshots'][slot] = snapshot
+
+    def is_done(self, key):
+        """
+        Check whether every thread of a node has sent its final results
+
+        Args:
+            key (tuple): the address and name of the node
+
+        Returns:
+            bool: True once the node is done
+        """
+
+        node = self.nodes[key]
+        done = set(thread for (thread, metric), snapshot in node['snapshots'].items() if snapshot['done'])
+
+        return len(done) >= node['threads']
+
+    def done_nodes(self):
+        """
+        Get the number of nodes that are done
+
+        Returns:
+            int: the nodes that have sent their final results
+        """
+
+        return sum(1 for key in self.nodes if self.is_done(key))
+
+    def merge(self):
+        """
+        Merge the histograms of the threads of every node, and of the fleet
+
+        Returns:
+            (nodes, fleet): the histogram of each metric of each node, and of the fleet
+        """
+
+        nodes = {}
+        fleet = {}
+
+        for key, node in sorted(self.nodes.items()):
+            merged = nodes.setdefault(key, {})
+
+            for (thread, metric), snapshot in sorted(node['snapshots'].items()):
+                histogram = Histogram.from_snapshot(snapshot['latency'], self.num_buckets)
+
+                if metric not in merged:
+                    merged[metric] = Histogram(histogram.bucket_width, self.num_buckets)
+                if metric not in fleet:
+                    fleet[metric] = Histogram(histogram.bucket_width, self.num_buckets)
+
+                if not merged[metric].merge(histogram) or not fleet[metric].merge(histogram):
+                    print('Warning: %s T:%d has another bucket width, not merged' % (key[1], thread))
+
+        return nodes, fleet
+
+def format_row(name, threads, histogram):
+    """
+    Format the statistics of a histogram as a row of the report
+
+    Args:
+        name (str): the node (or fleet)
+        threads (int): the threads merged
+        histogram (Histogram): the merged histogram
+
+    Returns:
+        str: the row
+    """
+
+    columns = [histogram.count, histogram.total / max(histogram.count, 1) / 1e3]
+    columns += [histogram.percentile(p) / 1e3 for p in PERCENTILES]
+    columns += [histogram.maximum / 1e3]
+
+    return '%-24s %3d %12d %9.2f' % ((name, threads) + tuple(columns[:2])) + \
+        ''.join(' %9.2f' % column for column in columns[2:])
+
+def print_report(collector, elapsed=None):
+    """
+    Print the statistics of every node and of the fleet, per metric
+
+    Args:
+        collector (Collector): the received snapshots
+        elapsed (float): the time since the start for a live report (None for the final one)
+    """
+
+    nodes, fleet = collector.merge()
+
+    if elapsed is not None:
+        # A live report only shows the fleet, which stays readable for many nodes
+        threads = sum(node['threads'] for node in collector.nodes.values())
+        for metric in [m for m in METRICS if m in fleet]:
+            print('[%7.1f s] ' % elapsed + format_row('%s (%d nodes)' % (metric, len(nodes)), threads, fleet[metric]))
+        return
+
+    for metric in [m for m in METRICS if m in fleet]:
+        print('\n# %s #' % metric.capitalize())
+        print('%-24s %3s %12s %9s' % ('Node', 'T', 'Count', 'Avg [us]') +
+              ''.join(' %9s' % ('P%g' % p) for p in PERCENTILES) + ' %9s' % 'Max')
+
+        for key in sorted(nodes):
+            if metric in nodes[key]:
+                name = key[1] + ('' if collector.is_done(key) else ' (partial)')
+                print(format_row(name, collector.nodes[key]['threads'], nodes[key][metric]))
+
+        threads = sum(node['threads'] for node in collector.nodes.values())
+        print(format_row('fleet (%d nodes)' % len(nodes), threads, fleet[metric]))
+
+def write_results(collector, filename):
+    """
+    Write the merged histograms of every node and of the fleet as JSON
+
+    Args:
+        collector (Collector): the received snapshots
+        filename (str): the path of the results file
+    """
+
+    nodes, fleet = collector.merge()
+
+    results = {
+        'nodes': [{
+            'node': key[1],
+            'address': key[0],
+            'threads': collector.nodes[key]['threads'],
+            'done': collector.is_done(key),
+            'metrics': dict((metric, histogram.to_dict()) for metric, histogram in nodes[key].items()),
+        } for key in sorted(nodes)],
+        'fleet': dict((metric, histogram.to_dict()) for metric, histogram in fleet.items()),
+    }
+
+    with open(filename, 'w') as f:
+        json.dump(results, f, indent=2)
+
+def local_address(node, port):
+    """
+    Get the address of this host that a node reaches it through
+
+    Args:
+        node (str): the node, as given to ssh ([user@]host)
+        port (int): the port of the collector
+
+    Returns:
+        str: the local address of the route to the node
+    """
+
+    probe = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    try:
+        probe.connect((node.split('@')[-1], port))
+        return probe.getsockname()[0]
+    finally:
+        probe.close()
+
+def launch_nodes(args, start_at):
+    """
+    Start the run on every node through ssh
+
+    Args:
+        args (Namespace): the options of the collector
+        start_at (int): the wall clock start time of the run in nsec since the epoch
+
+    Returns:
+        list: the ssh process of each node
+    """
+
+    if not os.path.isdir(args.log_dir):
+        os.makedirs(args.log_dir)
+
+    processes = []
+    for node in args.nodes:
+        collector = args.collector or local_address(node, args.port)
+
+        command = (['sudo', '-n'] if args.sudo else []) + [args.rt_test,
+                   '--report-to', '%s:%d' % (collector, args.port),
+                   '--start-at', '%dns' % start_at, '--node-name', node.split('@')[-1]] + args.rt_args
+        log = open(os.path.join(args.log_dir, node.split('@')[-1] + '.log'), 'w')
+
+        print('# %s: %s #' % (node, ' '.join(command)))
+        processes.append(subprocess.Popen(args.ssh.split() + [node, ' '.join(quote(c) for c in command)],
+                                          stdout=log, stderr=subprocess.STDOUT))
+
+    return processes
+
+def collect(collector, args, processes=None):
+    """
+    Receive the snapshots until every node is done, with a live fleet report
+
+    Args:
+        collector (Collector): the receiver of the snapshots
+        args (Namespace): the options of the collector
+        processes (list): the ssh processes of the nodes (None if not started here)
+    """
+
+    start = time.time()
+    next_report = start + args.interval
+    exited = None
+
+    try:
+        while True:
+            collector.receive(max(0.0, min(next_report - time.time(), 0.5)))
+
+            if time.time() >= next_report:
+                print_report(collector, time.time() - start)
+                next_report += args.interval
+
+            expected = len(args.nodes) if processes is not None else args.nodes
+            if expected and collector.done_nodes() >= expected:
+                break
+
+            # A node that exits without its final results (e.g. lost datagrams) is not waited for long
+            if processes is not None and all(p.poll() is not None for p in processes):
+                exited = exited or time.time()
+                if time.time() - exited > DONE_GRACE:
+                    break
+    except KeyboardInterrupt:
+        print('\nInterrupted, the results are partial')
+
+def parse_args():
+    """
+    Parse the options of the collector
+
+    Returns:
+        Namespace: the parsed options
+    """
+
+    parser = argparse.ArgumentParser(description='Run rt_test on a fleet of nodes and merge their histograms')
+    parser.add_argument('--port', type=int, default=DEFAULT_PORT, help='the UDP port to listen on')
+    parser.add_argument('--interval', type=float, default=1.0, help='the period of the live report in sec')
+    parser.add_argument('--buckets', type=int, default=1000,
+                        help='the histogram buckets of rt_test (HISTOGRAM_BUCKETS)')
+    parser.add_argument('--out', default='fleet.json', help='the merged results file')
+    commands = parser.add_subparsers(dest='command')
+
+    run = commands.add_parser('run', help='start the run on every node and collect it')
+    run.add_argument('--nodes', required=True, type=lambda text: text.split(','),
+                     help='the nodes, as given to ssh (comma separated)')
+    run.add_argument('--rt-test', default='./rt_test', help='the path of rt_test on the nodes')
+    run.add_argument('--ssh', default='ssh', help='the command the nodes are reached through')
+    run.add_argument('--sudo', action='store_true', help='run rt_test through sudo -n')
+    run.add_argument('--collector', help='the address the nodes reach the collector at (default: the route)')
+    run.add_argument('--start-delay', type=float, default=5.0,
+                     help='the time given to every node to start, before the common start time in sec')
+    run.add_argument('--log-dir', default='fleet_logs', help='the directory of the output of each node')
+    run.add_argument('rt_args', nargs=argparse.REMAINDER, help='the options of rt_test (after --)')
+
+    listen = commands.add_parser('listen', help='only collect the runs started elsewhere')
+    listen.add_argument('--nodes', type=int, default=0, help='stop once NUM nodes are done (0: at Ctrl-C)')
+
+    args = parser.parse_args()
+    if args.command is None:
+        parser.error('a command is needed')
+    if args.command == 'run':
+        args.rt_args = args.rt_args[1:] if args.rt_args[:1] == ['--'] else args.rt_args
+
+    return args
+
+if __name__ == '__main__':
+    args = parse_args()
+    collector = Collector(args.port, args.buckets)
+
+    if args.command == 'run':
+        start_at = int((time.time() + args.start_delay) * 1e9)
+        processes = launch_nodes(args, start_at)
+        collect(collector, args, processes)
+
+        for process in processes:
+            if process.poll() is None:
+                process.terminate()
+    else:
+        collect(collector, args)
+
+    print_report(collector)
+    write_results(collector, args.out)
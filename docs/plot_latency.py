@@ -1,63 +1,357 @@
-from sys import argv
+"""
+Analyze and plot the timestamps of rt_test in bounded memory
+
+The samples are read in chunks (memory mapped from a binary sample file, or
+parsed from a text timestamps file), and reduced on the fly to a histogram
+and to the min/percentiles/max of consecutive windows of samples, so that
+neither the analysis nor the plots grow with the length of the capture.
+
+Usage:
+    python docs/plot_latency.py timestamps.bin
+    python docs/plot_latency.py src/timestamps.txt --cycle-time 10ms
+"""
+
+from __future__ import print_function
+
+import argparse
 
 import numpy as np
+import matplotlib
+matplotlib.use('Agg')
 from matplotlib import pyplot as plt
 
-def parse_logfile(filename, cycle_time):
+# The header of a binary sample file (see src/sample_file.h)
+SAMPLE_FILE_HEADER = np.dtype([
+    ('magic', 'S8'),
+    ('version', '<u4'),
+    ('header_size', '<u4'),
+    ('record_size', '<u4'),
+    ('clock_id', '<i4'),
+    ('cycle_time', '<u8'),
+    ('cpu', '<u4'),
+    ('priority', '<u4'),
+    ('kernel', 'S88'),
+])
+
+# The samples read at a time (8 bytes each)
+CHUNK_SIZE = 1 << 20
+
+# The windows of the plots over time, so that a plot has a bounded number of points
+PLOT_WINDOWS = 2000
+
+# The percentiles of each window
+WINDOW_PERCENTILES = [50.0, 99.0, 99.9]
+
+# The buckets of the histogram, past which the latency is counted in an overflow bucket (as in
+# src/sched_statistics.h), so that a long stall does not grow the histogram
+HISTOGRAM_BUCKETS = 100000
+
+# The units the durations may be suffixed with, in nsec
+UNITS = [('ns', 1), ('us', 1000), ('ms', 1000000), ('s', 1000000000)]
+
+def parse_duration(text):
+    """
+    Parse a duration as given to rt_test (in msec unless suffixed)
+
+    Args:
+        text (str): the duration, e.g. 50us
+
+    Returns:
+        int: the duration in nsec
+    """
+
+    for suffix, unit in UNITS:
+        if text.endswith(suffix) and text[:-len(suffix)].replace('.', '', 1).isdigit():
+            return int(round(float(text[:-len(suffix)]) * unit))
+
+    return int(round(float(text) * 1000000))
+
+def map_sample_file(filename):
     """
-    Read the logfile and get x,y value arrays
+    Memory map a binary sample file
 
     Args:
-        filename (str): the path of the logfile
+        filename (str): the path of the sample file
 
     Returns:
-        (x, y): the x and y arrays
+        (header, records): the header and the int64 nsec timestamps
+    """
+
+    header = np.fromfile(filename, dtype=SAMPLE_FILE_HEADER, count=1)[0]
+
+    if header['magic'] != b'RTSAMPLE' or header['record_size'] != 8:
+        raise ValueError('%s is not a sample file' % filename)
+
+    records = np.memmap(filename, dtype='<i8', mode='r',
+                        offset=int(header['header_size']))
+
+    return header, records
+
+def read_sample_chunks(records):
+    """
+    Get the chunks of a memory mapped sample file
+
+    Args:
+        records (memmap): the int64 nsec timestamps
+
+    Yields:
+        ndarray: the next chunk of timestamps
+    """
+
+    for start in range(0, len(records), CHUNK_SIZE):
+        yield np.asarray(records[start:start + CHUNK_SIZE])
+
+def read_text_chunks(filename):
+    """
+    Parse the timestamps of a text timestamps file in chunks
+
+    Args:
+        filename (str): the path of the timestamps file
+
+    Yields:
+        ndarray: the next chunk of int64 nsec timestamps
     """
 
     with open(filename) as f:
-        data = f.read()
+        for line in f:
+            if line.startswith('# Timestamps #'):
+                break
+
+        while True:
+            lines = f.readlines(CHUNK_SIZE * 21)
+            if not lines:
+                return
+
+            # Each line is sec.nsec with 9 digits of nsec, so dropping the dot gives the nsec exactly
+            text = ''.join(lines).replace('.', '')
+            yield np.array(text.split(), dtype=np.int64)
+
+class LatencyAnalysis(object):
+    """
+    The streaming reduction of the latency of every sample
+
+    The latency of each sample is its distance from the expected timestamp,
+    which is computed from the first one in integer math so that it does
+    not drift over a long capture.
+    """
+
+    def __init__(self, cycle_time, bucket_width, window, buckets=HISTOGRAM_BUCKETS):
+        self.cycle_time = np.int64(cycle_time)
+        self.bucket_width = bucket_width
+        self.window = window
+        self.buckets = buckets
+
+        self.first = None
+        self.count = 0
+        self.total = 0
+        self.maximum = 0
+        # The last bucket is the overflow, whose latency is only known by the maximum
+        self.histogram = np.zeros(buckets + 1, dtype=np.int64)
+
+        # The window that is being filled, and the reduction of the done ones
+        self.pending = np.zeros(0, dtype=np.int64)
+        self.windows = []
+
+    def add(self, timestamps):
+        """
+        Add a chunk of timestamps
+
+        Args:
+            timestamps (ndarray): the int64 nsec timestamps, in order
+        """
 
-    timestamps = data.split("\n", 6)[6].splitlines()
-    latency = []
+        if len(timestamps) == 0:
+            return
 
-    for i in xrange(1, len(timestamps)):
-    	actual_timestamp = float(timestamps[i])
-    	expected_timestamp = float(timestamps[0]) + float(cycle_time) * i
-    	latency.append(abs(actual_timestamp - expected_timestamp))
+        if self.first is None:
+            self.first = timestamps[0]
+            timestamps = timestamps[1:]
+            self.count = 1
 
-    timestamps.pop(0)
+        index = np.arange(self.count, self.count + len(timestamps), dtype=np.int64)
+        latency = np.abs(timestamps - (self.first + self.cycle_time * index))
+        self.count += len(timestamps)
 
-    x = np.asarray(timestamps, dtype=float)
-    y = np.asarray(latency, dtype=float)
+        self.total += int(latency.sum())
+        if len(latency):
+            self.maximum = max(self.maximum, int(latency.max()))
 
-    x = x - x[0]  # x: start from 0
-    y = y * 1000000  # y: convert in usec
+        buckets = np.minimum(latency // self.bucket_width, self.buckets)
+        self.histogram += np.bincount(buckets, minlength=self.buckets + 1)
 
-    return x, y
+        self.add_windows(latency)
 
-def generate_plot(x, y):
+    def add_windows(self, latency):
+        """
+        Reduce the latency to the windows over time
+
+        Args:
+            latency (ndarray): the latency of the next samples in nsec
+        """
+
+        latency = np.concatenate((self.pending, latency))
+        done = (len(latency) // self.window) * self.window
+
+        if done > 0:
+            windows = latency[:done].reshape(-1, self.window)
+            percentiles = np.percentile(windows, WINDOW_PERCENTILES, axis=1)
+            self.windows.append(np.column_stack((windows.min(axis=1), percentiles.T, windows.max(axis=1))))
+
+        self.pending = latency[done:]
+
+    def finish(self):
+        """
+        Reduce the last (partial) window
+
+        Returns:
+            ndarray: the min, percentiles and max of each window in nsec
+        """
+
+        if len(self.pending) > 0:
+            percentiles = np.percentile(self.pending, WINDOW_PERCENTILES)
+            self.windows.append(np.concatenate(([self.pending.min()], percentiles, [self.pending.max()]))[np.newaxis, :])
+            self.pending = np.zeros(0, dtype=np.int64)
+
+        if not self.windows:
+            return np.zeros((0, len(WINDOW_PERCENTILES) + 2))
+
+        return np.concatenate(self.windows)
+
+    def percentile(self, percentile):
+        """
+        Get a percentile of the latency from the histogram
+
+        Args:
+            percentile (float): the percentile, e.g. 99.9
+
+        Returns:
+            float: the upper bound of its bucket (the maximum past the histogram) in nsec
+        """
+
+        cdf = np.cumsum(self.histogram)
+        if cdf[-1] == 0:
+            return 0.0
+
+        bucket = np.searchsorted(cdf, (percentile / 100.0) * cdf[-1])
+        if bucket >= self.buckets:
+            return float(self.maximum)
+
+        return float((bucket + 1) * self.bucket_width)
+
+def print_summary(analysis):
+    """
+    Print the statistics of the latency
+
+    Args:
+        analysis (LatencyAnalysis): the reduced latency
+    """
+
+    samples = max(analysis.count - 1, 1)
+
+    print('Samples: %d' % analysis.count)
+    print('Average Latency: %.2f us' % (analysis.total / float(samples) / 1e3))
+    for percentile in [50.0, 99.0, 99.9, 99.99]:
+        print('P%g Latency: %.2f us' % (percentile, analysis.percentile(percentile) / 1e3))
+    print('Max Latency: %.2f us' % (analysis.maximum / 1e3))
+    print('Past Histogram: %d samples (>= %.2f us)' %
+          (analysis.histogram[-1], analysis.buckets * analysis.bucket_width / 1e3))
+
+def generate_plots(analysis, windows, prefix):
     """
-    Given x and y arrays, generate a plot
+    Plot the latency over the samples, its percentiles over time and its histogram
 
     Args:
-        x (double array): the time values in sec
-        y (double array): the latency values in usec
+        analysis (LatencyAnalysis): the reduced latency
+        windows (ndarray): the min, percentiles and max of each window in nsec
+        prefix (str): the prefix of the plot files
     """
-    
+
+    x = np.arange(len(windows)) * analysis.window
+
+    # The min/max envelope of each window keeps every outlier visible after the decimation
+    figure = plt.figure(figsize=(10, 6))
+    axes = figure.add_subplot(1, 1, 1)
+    axes.set_xlabel('Samples', fontsize=18)
+    axes.set_ylabel('Latency [usec]', fontsize=18)
+    axes.fill_between(x, windows[:, 0] / 1e3, windows[:, -1] / 1e3, color='grey', step='post')
+    axes.margins(0.04)
+    figure.tight_layout()
+    figure.savefig(prefix + '.png', dpi=60, bbox_inches='tight')
+    plt.close(figure)
+
     figure = plt.figure(figsize=(10, 6))
-    # figure.suptitle('Timestamp - Latency', fontsize=24)
     axes = figure.add_subplot(1, 1, 1)
     axes.set_xlabel('Samples', fontsize=18)
     axes.set_ylabel('Latency [usec]', fontsize=18)
-    axes.bar(x, y, width=0.1, color="grey")
-    axes.set_xticks([])
+    for i, percentile in enumerate(WINDOW_PERCENTILES):
+        axes.step(x, windows[:, i + 1] / 1e3, where='post', label='P%g' % percentile)
+    axes.step(x, windows[:, -1] / 1e3, where='post', label='Max', color='grey')
+    axes.set_yscale('log')
+    axes.legend()
     axes.margins(0.04)
+    figure.tight_layout()
+    figure.savefig(prefix + '_percentiles.png', dpi=60, bbox_inches='tight')
+    plt.close(figure)
 
-    # figure.autofmt_xdate()
+    figure = plt.figure(figsize=(10, 6))
+    axes = figure.add_subplot(1, 1, 1)
+    axes.set_xlabel('Latency [usec]', fontsize=18)
+    axes.set_ylabel('Samples', fontsize=18)
+    # Up to the last bucket in use, the overflow is only printed
+    used = np.flatnonzero(analysis.histogram[:-1])
+    histogram = analysis.histogram[:(used[-1] + 1) if len(used) else 0]
+    edges = np.arange(len(histogram) + 1) * analysis.bucket_width / 1e3
+    axes.stairs(histogram, edges, fill=True, color='grey')
+    axes.set_yscale('log')
+    axes.margins(0.04)
     figure.tight_layout()
-    figure.subplots_adjust(top=0.88)
-    figure.savefig('latency.png', dpi=60, bbox_inches='tight')
+    figure.savefig(prefix + '_histogram.png', dpi=60, bbox_inches='tight')
+    plt.close(figure)
+
+def parse_args():
+    """
+    Parse the options of the analyzer
+
+    Returns:
+        Namespace: the parsed options
+    """
+
+    parser = argparse.ArgumentParser(description='Analyze and plot the timestamps of rt_test')
+    parser.add_argument('file', help='a binary sample file (.bin) or a text timestamps file')
+    parser.add_argument('--cycle-time', help='the cycle time of a text file (msec unless suffixed)')
+    parser.add_argument('--bucket-width', default='1us', help='the width of a histogram bucket')
+    parser.add_argument('--buckets', type=int, default=HISTOGRAM_BUCKETS,
+                        help='the buckets of the histogram, past which the latency overflows (default: %d)' %
+                        HISTOGRAM_BUCKETS)
+    parser.add_argument('--window', type=int, default=0,
+                        help='the samples of each point over time (default: %d points)' % PLOT_WINDOWS)
+    parser.add_argument('--out', default='latency', help='the prefix of the plot files')
+    parser.add_argument('--no-plot', action='store_true', help='only print the statistics')
+
+    return parser.parse_args()
 
 if __name__ == '__main__':
-    x, y = parse_logfile('../src/timestamps.txt', argv[1])
-    generate_plot(x, y)
+    args = parse_args()
+
+    if args.file.endswith('.bin'):
+        header, records = map_sample_file(args.file)
+        cycle_time = int(header['cycle_time'])
+        chunks = read_sample_chunks(records)
+        window = args.window or max(1, len(records) // PLOT_WINDOWS)
+    else:
+        if args.cycle_time is None:
+            raise SystemExit('A text timestamps file needs --cycle-time')
+        cycle_time = parse_duration(args.cycle_time)
+        chunks = read_text_chunks(args.file)
+        window = args.window or 10000
+
+    analysis = LatencyAnalysis(cycle_time, max(1, parse_duration(args.bucket_width)), window,
+                               max(1, args.buckets))
+    for chunk in chunks:
+        analysis.add(chunk)
+
+    windows = analysis.finish()
+    print_summary(analysis)
+
+    if not args.no_plot:
+        generate_plots(analysis, windows, args.out)
@@ -15,49 +15,157 @@
 #include <stdio.h>
 #include <time.h>
 #include <string.h>
+#include <limits.h>
+#include <errno.h>
 
 #include <sched.h>
+#include <signal.h>
+#include <unistd.h>
 #include <pthread.h>
+#include <semaphore.h>
 #include <sys/mman.h>
 
+#include "sched_config.h"
 #include "sched_statistics.h"
+#include "sched_workload.h"
+#include "sched_interference.h"
+#include "sched_preflight.h"
+#include "sched_pingpong.h"
+#include "sched_clock.h"
+#include "sched_calibration.h"
+#include "sample_ring.h"
+#include "sample_file.h"
+#include "sched_load.h"
+#include "sched_trace.h"
+#include "sched_summary.h"
+#include "sched_export.h"
+#include "sched_arena.h"
+#include "sched_policy.h"
 
 /***************************** Macro Definitions *****************************/
 
-/** The CPU affinity of the process. */
-#define NUM_CPUS (0u)
-
-/** The priority that will be given to the created tasks (threads) from the OS.
-  * Since the PRREMPT_RT uses 50 as the priority of kernel tasklets and
-  * interrupt handlers by default, the maximum available priority is chosen.
-  * The priority of each task should be the same, since the Round-Robin
-  * scheduling policy is used and each task is executed with the same
-  * time slice.
+/** The CPU affinity of the process (the measurement threads are pinned
+  * separately, see sched_config).
   */
-#define TASK_PRIORITY (49u)
+#ifndef NUM_CPUS
+#define NUM_CPUS (0u)
+#endif
 
 /** This is the maximum size of the stack which is
   * guaranteed safe access without faulting.
   */
+#ifndef MAX_SAFE_STACK
 #define MAX_SAFE_STACK (128u * 1024u)
+#endif
+
+/** The stack size of each measurement thread. Since all memory is locked,
+  * the default stack size (usually 8 MB) would be resident for every thread.
+  */
+#define TASK_STACK_SIZE (MAX_SAFE_STACK + PTHREAD_STACK_MIN)
+
+/** The name of the timestamps file (per thread when more than one runs). */
+#define TIMESTAMPS_FILE "timestamps.%s"
+#define THREAD_TIMESTAMPS_FILE "timestamps_%u.%s"
+
+/** The number of samples the writer pops from a ring at once. */
+#define WRITER_BATCH (1024u)
 
-/** The number of nsecs per sec/msec. */
-#define NSEC_PER_SEC (1000000000ul)
-#define NSEC_PER_MSEC (1000000ul)
+/** How long the writer sleeps when all rings are empty (in nsec). */
+#define WRITER_PERIOD (10u * NSEC_PER_MSEC)
+
+/** How far in the future the common start of the threads is set (in nsec). */
+#define START_DELAY (NSEC_PER_MSEC)
+
+/***************************** Type Definitions ******************************/
+
+/** The state of each measurement thread. */
+typedef struct
+{
+  u32_t id;                         /**< The index of the thread. */
+  u32_t cpu;                        /**< The CPU the thread is pinned to. */
+  u32_t priority;                   /**< The priority of the thread. */
+  pthread_t thread;                 /**< The handle of the thread. */
+  struct timespec main_task_timer;  /**< The main timer of the scheduler. */
+  struct timespec cycle_interval;   /**< The cycle time, split into sec and nsec. */
+  s64_t* timestamps;                /**< The saved timestamp of each sample in nsec. */
+  sched_statistics_t* stats;        /**< The statistics of the thread. */
+  sample_ring_t* ring;              /**< The ring the samples are streamed to. */
+  FILE* stream_file;                /**< The file the writer drains the ring to. */
+  u64_t written;                    /**< The samples written by the writer. */
+  u64_t cycle_time;                 /**< The cycle time of the thread in nsec. */
+  u64_t cycle_num;                  /**< The cycles the thread runs for (0 for unbounded). */
+  u64_t work;                       /**< The busy work of each cycle in nsec. */
+  workload_t workload;              /**< The synthetic work run every cycle. */
+  interference_t* interference;     /**< The interference counters (NULL if not counted). */
+  pingpong_t* pingpong;             /**< The handoff of the pair of the thread (NULL without one). */
+  u8_t wakee;                       /**< Whether the thread is woken by its pair (instead of a timer). */
+  u64_t cycles;                     /**< The cycles the thread has run for. */
+} task_context_t;
 
 /***************************** Static Variables ******************************/
 
-/** The cycle time between the task calls. */
-static u64_t cycle_time;
+/** The configuration of the run. */
+static sched_config_t config;
+
+/** The state of each measurement thread. */
+static task_context_t tasks[MAX_THREADS];
+
+/** The measured overhead of each clock backend. */
+static overhead_statistics_t overheads[CLOCK_SOURCE_COUNTER + 1];
+
+/** The overhead subtracted from the wakeup latency. */
+static s64_t subtracted_overhead;
+
+/** Every measurement thread waits on it, before the start time is agreed on. */
+static pthread_barrier_t start_barrier;
+
+/** The common start time of the measurement threads in nsec. */
+static s64_t start_time;
+
+/** The writer that drains the rings in stream mode. */
+static pthread_t writer_thread;
+
+/** Whether the measurement threads are still producing samples. */
+static u8_t writer_running;
+
+/** Set by a signal, a breach (or the end of a timed run) to stop every thread after its cycle. */
+static u8_t run_stopped;
+
+/** Posted along with the stop, so that the main thread wakes up before the duration ends. */
+static sem_t stop_semaphore;
+
+/** The measurement threads that have not finished their cycles yet. */
+static u32_t running_threads;
+
+/** The reporter that prints the statistics periodically. */
+static pthread_t reporter_thread;
+
+/** Whether the run is still going (protected by the report lock). */
+static u8_t reporter_running;
+
+/** Wakes up the reporter at the end of the run. */
+static pthread_mutex_t report_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t report_cond;
+
+/** The interrupts of each CPU, as last read by the main or the reporter thread. */
+static u64_t irq_counts[MAX_INTERRUPT_CPUS];
+
+/** The system-wide interference of each thread at the last report. */
+static u64_t report_irqs[MAX_THREADS];
+static u64_t report_smis[MAX_THREADS];
+static u64_t report_involuntary[MAX_THREADS];
+
+/** The results of each thread, as given to the summaries. */
+static summary_thread_t summary_threads[MAX_THREADS];
 
-/** The number of cycles the program will run for. */
-static u64_t cycle_num;
+/** The snapshot the reporter prints (too large for the stack). */
+static sched_statistics_t report_snapshot;
 
-/** The saved timestamp of each sample. */
-static f32_t* timestamps;
+/** The reports printed (and sent to the collector) so far. */
+static u64_t report_sequence;
 
-/** The main timer of the scheduler. */
-static struct timespec main_task_timer;
+/** Advanced by the reporter, so that every thread captures its interference counters. */
+static u32_t capture_request;
 
 /******************** Static General Function Prototypes *********************/
 
@@ -69,15 +177,131 @@ static void prefaultStack(void);
 
 /**
   * @brief Update the scheduler's timer with a new interval.
-  * @param interval The interval needed to perform the update.
+  * @param timer The timer to update.
+  * @param interval The interval needed to perform the update,
+  *        already split into sec and nsec (with tv_nsec below a sec).
   * @return Void.
   */
-static void updateInterval(u64_t interval);
+static void updateInterval(struct timespec* timer, const struct timespec* interval);
+
+/**
+  * @brief Wait until the next shot of the scheduler's timer.
+  * @param shot The absolute time of the next shot.
+  * @return Void.
+  */
+static void waitForShot(const struct timespec* shot);
+
+/**
+  * @brief Print a timestamp as seconds, without any floating point rounding.
+  * @param file The stream to print to.
+  * @param timestamp The timestamp in nsec.
+  * @return Void.
+  */
+static void printTimestamp(FILE* file, s64_t timestamp);
+
+/**
+  * @brief Open the results file of a thread.
+  * @param task The measurement thread to open the file of.
+  * @return The opened file, NULL on failure.
+  */
+static FILE* openResultsFile(const task_context_t* task);
+
+/**
+  * @brief Append samples to a results file in the output format.
+  * @param file The results file to append to.
+  * @param samples The samples to write.
+  * @param count The number of samples.
+  * @return Void.
+  */
+static void writeSamples(FILE* file, const sample_t* samples, u64_t count);
+
+/**
+  * @brief Write the samples popped from a ring to the thread's file.
+  * @param task The measurement thread to drain the ring of.
+  * @return The number of samples written.
+  */
+static u64_t drainRing(task_context_t* task);
+
+/**
+  * @brief Write the statistics and the timestamps of a thread to file/console.
+  * @param task The measurement thread to write the results of.
+  * @param verbose Also print the timestamps to console.
+  * @return Void.
+  */
+static void writeResults(const task_context_t* task, u8_t verbose);
+
+/**
+  * @brief Stop the run, so that the results collected so far are written.
+  * @details Async-signal-safe, since it is installed for SIGINT and SIGTERM,
+  *          and never blocks, since the RT threads stop the run at a breach.
+  *          A second signal restores the tuning and kills the process.
+  * @param signal The signal that stopped the run.
+  * @return Void.
+  */
+static void stopRun(int signal);
+
+/**
+  * @brief Check whether the run has been stopped.
+  * @return TRUE once the run has been stopped.
+  */
+static u8_t isRunStopped(void);
+
+/**
+  * @brief Count a measurement thread out, and wake the main thread once the last one is done.
+  * @details Never blocks, so that it may be called by the RT threads.
+  * @return Void.
+  */
+static void finishThread(void);
+
+/**
+  * @brief Wait for the duration of a timed run (or a signal), then stop it.
+  * @return Void.
+  */
+static void waitForDuration(void);
+
+/**
+  * @brief Wait for the wall clock start time of the run (or a signal).
+  * @param signals The (blocked) signals that stop the run.
+  * @return Void.
+  */
+static void waitForStart(const sigset_t* signals);
+
+/**
+  * @brief Fill the results of a thread, as given to the summaries.
+  * @param summary The results to fill.
+  * @param task The measurement thread.
+  * @param stats The statistics of the thread (or a snapshot of them).
+  * @return Void.
+  */
+static void fillSummaryThread(summary_thread_t* summary, const task_context_t* task,
+                              const sched_statistics_t* stats);
+
+/**
+  * @brief Write the machine-readable summaries of the run, if requested.
+  * @return Void.
+  */
+static void writeSummaries(void);
+
+/**
+  * @brief Read the interrupts and SMIs of the CPU of every thread.
+  * @param at_start Whether the run is starting (or ending).
+  * @return Void.
+  */
+static void sampleInterference(u8_t at_start);
+
+/**
+  * @brief Print the interference of every thread since the last report.
+  * @return Void.
+  */
+static void reportInterference(void);
 
 /********************* Static Task Function Prototypes ***********************/
 
 static void INIT_TASK(int argc, char** argv);
 static void* MAIN_TASK(void* ptr);
+static void* WAKEE_TASK(void* ptr);
+static void* WRITER_TASK(void* ptr);
+static void* REPORT_TASK(void* ptr);
 static void EXIT_TASK(void);
 
 /************************** Static General Functions *************************/
@@ -91,15 +315,337 @@ void prefaultStack(void)
   return;
 }
 
-void updateInterval(u64_t interval)
+void updateInterval(struct timespec* timer, const struct timespec* interval)
 {
-  main_task_timer.tv_nsec += interval;
+  /* The interval is split once, so that no division is done on every cycle
+   * and tv_nsec (a 32-bit long on ARMv7) never overflows.
+   */
+  timer->tv_sec += interval->tv_sec;
+  timer->tv_nsec += interval->tv_nsec;
 
   /* Normalize time (when nsec have overflowed) */
-  while (main_task_timer.tv_nsec >= NSEC_PER_SEC)
+  if (timer->tv_nsec >= (long)NSEC_PER_SEC)
+  {
+    timer->tv_nsec -= NSEC_PER_SEC;
+    timer->tv_sec++;
+  }
+}
+
+void waitForShot(const struct timespec* shot)
+{
+  struct timespec early_shot;
+  const s64_t deadline = timespecToNsec(shot);
+
+  switch (config.wait_mode)
+  {
+    case WAIT_MODE_SLEEP:
+      (void)clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, shot, NULL);
+      return;
+
+    case WAIT_MODE_HYBRID:
+      /* Sleep through most of the cycle, and spin only for the margin. */
+      nsecToTimespec(deadline - (s64_t)config.spin_margin, &early_shot);
+      (void)clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &early_shot, NULL);
+      /* fall through */
+
+    case WAIT_MODE_SPIN:
+      while (getClockNsec() < deadline)
+        ;
+      return;
+  }
+}
+
+void printTimestamp(FILE* file, s64_t timestamp)
+{
+  fprintf(file, "%lld.%09lld\n", timestamp / (s64_t)NSEC_PER_SEC, timestamp % (s64_t)NSEC_PER_SEC);
+}
+
+FILE* openResultsFile(const task_context_t* task)
+{
+  const u8_t binary = (config.output_format == OUTPUT_FORMAT_BINARY);
+  const char* extension = binary ? "bin" : "txt";
+  sample_file_header_t header;
+  char filename[32];
+  FILE* file;
+
+  if (config.num_threads == 1u)
+    (void)snprintf(filename, sizeof(filename), TIMESTAMPS_FILE, extension);
+  else
+    (void)snprintf(filename, sizeof(filename), THREAD_TIMESTAMPS_FILE, task->id, extension);
+
+  file = fopen(filename, binary ? "wb" : "w");
+
+  if ((file != NULL) && binary)
+  {
+    initSampleFileHeader(&header, task->cycle_time, getClockId(), task->cpu, task->priority);
+
+    if (!writeSampleFileHeader(file, &header))
+    {
+      fclose(file);
+      file = NULL;
+    }
+  }
+
+  return file;
+}
+
+void writeSamples(FILE* file, const sample_t* samples, u64_t count)
+{
+  u64_t i;
+
+  /* Samples are already in the record format. */
+  if (config.output_format == OUTPUT_FORMAT_BINARY)
+  {
+    (void)writeSampleRecords(file, samples, count);
+    return;
+  }
+
+  for (i = 0u; i < count; i++)
+    printTimestamp(file, samples[i]);
+}
+
+u64_t drainRing(task_context_t* task)
+{
+  sample_t samples[WRITER_BATCH];
+  u64_t count, total = 0u;
+
+  while ((count = popSamples(task->ring, samples, WRITER_BATCH)) > 0u)
+  {
+    writeSamples(task->stream_file, samples, count);
+    total += count;
+  }
+
+  task->written += total;
+
+  return total;
+}
+
+void writeResults(const task_context_t* task, u8_t verbose)
+{
+  FILE* file;
+  u64_t i;
+
+  /* In stream mode the writer already wrote the samples. */
+  if (task->ring != NULL)
+  {
+    if (verbose)
+      printStatistics(task->stats, NULL);
+
+    printf("\nT:%2u Written Samples: %llu Dropped Samples: %llu\n",
+           task->id, task->written, getDroppedSamples(task->ring));
+    return;
+  }
+
+  file = openResultsFile(task);
+
+  if (file == NULL)
+    return;
+
+  if (verbose)
+    printStatistics(task->stats, NULL);  /* Print statistics to console */
+
+  /* A binary file holds the samples only. */
+  if (config.output_format == OUTPUT_FORMAT_BINARY)
+  {
+    if (task->timestamps != NULL)
+      writeSamples(file, task->timestamps, task->cycles);
+
+    fclose(file);
+    return;
+  }
+
+  printStatistics(task->stats, file);    /* Print statistics to file */
+
+  if (task->timestamps != NULL)
+  {
+    if (verbose)
+      printf("\n# Timestamps #\n");
+    fprintf(file, "\n# Timestamps #\n");
+
+    if (verbose)
+      for (i = 0; i < task->cycles; i++)
+        printTimestamp(stdout, task->timestamps[i]);
+
+    writeSamples(file, task->timestamps, task->cycles);
+  }
+
+  fclose(file);
+}
+
+void stopRun(int signal)
+{
+  static u8_t signalled;
+  struct sigaction action;
+
+  /* The threads did not stop on the first signal, so the tuning is restored
+   * here, since the default action kills the process without running atexit. */
+  if ((signal != 0) && __atomic_exchange_n(&signalled, TRUE, __ATOMIC_RELAXED))
+  {
+    if (config.tune)
+      restoreTuning();
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = SIG_DFL;
+    sigemptyset(&action.sa_mask);
+    (void)sigaction(signal, &action, NULL);
+    (void)raise(signal);
+    return;
+  }
+
+  __atomic_store_n(&run_stopped, TRUE, __ATOMIC_RELAXED);
+  (void)sem_post(&stop_semaphore);
+}
+
+u8_t isRunStopped(void)
+{
+  return __atomic_load_n(&run_stopped, __ATOMIC_RELAXED);
+}
+
+void finishThread(void)
+{
+  /* A timed run ends early once every thread has run its cycles. */
+  if (__atomic_sub_fetch(&running_threads, 1u, __ATOMIC_RELEASE) == 0u)
+    (void)sem_post(&stop_semaphore);
+}
+
+void waitForDuration(void)
+{
+  struct timespec end;
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  nsecToTimespec(timespecToNsec(&end) + (s64_t)config.duration, &end);
+
+  /* A signal interrupts the wait, and has posted the stop by then. */
+  while ((sem_clockwait(&stop_semaphore, CLOCK_MONOTONIC, &end) != 0) && (errno == EINTR))
+    ;
+
+  stopRun(0);
+}
+
+void waitForStart(const sigset_t* signals)
+{
+  struct timespec now, remaining;
+  s64_t left;
+  int signal;
+
+  /* A start time that has passed starts the run at once. */
+  for (;;)
+  {
+    clock_gettime(CLOCK_REALTIME, &now);
+    if ((left = (s64_t)config.start_at - timespecToNsec(&now)) <= 0)
+      return;
+
+    nsecToTimespec(left, &remaining);
+
+    if ((signal = sigtimedwait(signals, NULL, &remaining)) > 0)
+    {
+      stopRun(signal);
+      return;
+    }
+  }
+}
+
+void fillSummaryThread(summary_thread_t* summary, const task_context_t* task,
+                       const sched_statistics_t* stats)
+{
+  summary->id = task->id;
+  summary->cpu = task->cpu;
+  summary->priority = task->priority;
+  summary->cycles = task->cycles;
+  summary->work = task->work;
+  summary->working_set = task->workload.working_set_size;
+  summary->stats = stats;
+  summary->interference = task->interference;
+}
+
+void writeSummaries(void)
+{
+  FILE* file;
+  u32_t i;
+
+  for (i = 0; i < config.num_threads; i++)
+    fillSummaryThread(&summary_threads[i], &tasks[i], tasks[i].stats);
+
+  if (config.json_file != NULL)
+  {
+    if ((file = fopen(config.json_file, "w")) == NULL)
+      perror("Could not open JSON summary");
+    else
+    {
+      writeSummaryJson(file, &config, summary_threads, config.num_threads,
+                       overheads, CLOCK_SOURCE_COUNTER + 1);
+      fclose(file);
+    }
+  }
+
+  if (config.csv_file != NULL)
+  {
+    if ((file = fopen(config.csv_file, "w")) == NULL)
+      perror("Could not open CSV summary");
+    else
+    {
+      writeSummaryCsv(file, summary_threads, config.num_threads);
+      fclose(file);
+    }
+  }
+}
+
+void sampleInterference(u8_t at_start)
+{
+  interference_t* interference;
+  u64_t smis;
+  u32_t i;
+
+  (void)readInterrupts(irq_counts, MAX_INTERRUPT_CPUS);
+
+  for (i = 0; i < config.num_threads; i++)
+  {
+    interference = tasks[i].interference;
+
+    if (at_start)
+    {
+      interference->irqs_start = irq_counts[tasks[i].cpu % MAX_INTERRUPT_CPUS];
+      interference->has_smis = readSmiCount(tasks[i].cpu, &interference->smis_start);
+
+      report_irqs[i] = interference->irqs_start;
+      report_smis[i] = interference->smis_start;
+    }
+    else
+    {
+      interference->irqs_end = irq_counts[tasks[i].cpu % MAX_INTERRUPT_CPUS];
+      if (!readSmiCount(tasks[i].cpu, &smis))
+        smis = interference->smis_start;
+      interference->smis_end = smis;
+    }
+  }
+}
+
+void reportInterference(void)
+{
+  u64_t irqs, smis, involuntary;
+  u32_t i;
+
+  (void)readInterrupts(irq_counts, MAX_INTERRUPT_CPUS);
+
+  for (i = 0; i < config.num_threads; i++)
   {
-    main_task_timer.tv_nsec -= NSEC_PER_SEC;
-    main_task_timer.tv_sec++;
+    irqs = irq_counts[tasks[i].cpu % MAX_INTERRUPT_CPUS];
+    if (!tasks[i].interference->has_smis || !readSmiCount(tasks[i].cpu, &smis))
+      smis = report_smis[i];
+
+    /* The threads capture their counters on their next cycle, so this is as of the last report. */
+    involuntary = __atomic_load_n(&tasks[i].interference->total.involuntary, __ATOMIC_RELAXED);
+
+    printf("T:%2u CPU:%3u IRQs: %llu SMIs: ", tasks[i].id, tasks[i].cpu, irqs - report_irqs[i]);
+    if (tasks[i].interference->has_smis)
+      printf("%llu", (smis - report_smis[i]) & U32_MAX);
+    else
+      printf("n/a");
+    printf(" Involuntary CSW: %llu\n", involuntary - report_involuntary[i]);
+
+    report_irqs[i] = irqs;
+    report_smis[i] = smis;
+    report_involuntary[i] = involuntary;
   }
 }
 
@@ -107,68 +653,499 @@ void updateInterval(u64_t interval)
 
 void INIT_TASK(int argc, char** argv)
 {
-  if (argc != 3)
+  sample_file_t map;
+  u64_t arena_size;
+  u8_t* working_set;
+  u32_t i;
+
+  parseConfig(argc, argv, &config);
+
+  /* Only convert a sample file to text, without running any task. */
+  if (config.dump_file != NULL)
+  {
+    if (!mapSampleFile(config.dump_file, &map))
+    {
+      fprintf(stderr, "Could not read sample file: %s\n", config.dump_file);
+      exit(-4);
+    }
+
+    printSampleFile(&map, stdout);
+    unmapSampleFile(&map);
+    exit(0);
+  }
+
+  /* The system is checked (and tuned) first, so that the calibrations run on it as well. */
+  if (config.preflight)
+    (void)checkPreflight(config.cpus, config.num_threads);
+
+  if (config.tune)
+    applyTuning(config.cpus, config.num_threads);
+
+  /* Calibrate every backend, so that the results of different targets compare. */
+  if (config.calibration_loops > 0u)
+  {
+    for (i = CLOCK_SOURCE_MONOTONIC; i <= CLOCK_SOURCE_COUNTER; i++)
+      if (calibrateOverhead(&overheads[i], (clock_source_t)i, config.calibration_loops))
+        printOverhead(&overheads[i], NULL);
+
+    if (config.subtract_overhead)
+      subtracted_overhead = getMedianOverhead(&overheads[config.clock_source]);
+  }
+
+  if (!initClock(config.clock_source))
+  {
+    fprintf(stderr, "The selected clock is not supported on this CPU (or by this build)\n");
+    exit(-4);
+  }
+
+  if (getCounterFrequency() != 0u)
+    printf("# Clock: %s (%.3f MHz) #\n", getClockName(), getCounterFrequency() / 1e6);
+
+  /* The work is a number of iterations, measured once, so that preemption does not count as work. */
+  for (i = 0; (i < config.num_threads) && (config.work[i] == 0u); i++)
+    ;
+
+  if (i < config.num_threads)
+  {
+    calibrateWorkload();
+    printf("# Workload: %.1f loops/us #\n", getSpinRate());
+  }
+
+  if ((config.report_target != NULL) && !initExport(config.report_target, config.node_name))
   {
-    perror("Wrong number of arguments");
+    fprintf(stderr, "Could not resolve the collector: %s\n", config.report_target);
     exit(-4);
   }
 
-  cycle_time = strtoul(argv[1], NULL, 0) * NSEC_PER_MSEC;
-  cycle_num = strtoul(argv[2], NULL, 0);
+  if ((config.break_threshold > 0u) && !initTrace(config.break_threshold))
+    fprintf(stderr, "ftrace is not available, only the context of a breach is recorded\n");
+
+  /* Every buffer of the RT path is carved out of one prefaulted arena. */
+  for (i = 0, arena_size = 0u; i < config.num_threads; i++)
+  {
+    arena_size += getArenaFootprint(sizeof(sched_statistics_t), CACHE_LINE_SIZE) +
+                  getArenaFootprint(config.working_sets[i], CACHE_LINE_SIZE);
+    if (config.interference)
+      arena_size += getArenaFootprint(sizeof(interference_t), CACHE_LINE_SIZE);
+    if (config.pingpong && ((i % 2u) == 0u))
+      arena_size += getArenaFootprint(sizeof(pingpong_t), CACHE_LINE_SIZE);
+    if (config.sample_mode == SAMPLE_MODE_BUFFER)
+      arena_size += getArenaFootprint(sizeof(s64_t) * config.cycle_nums[i], CACHE_LINE_SIZE);
+    else if (config.sample_mode == SAMPLE_MODE_STREAM)
+      arena_size += getArenaFootprint(sizeof(sample_ring_t), CACHE_LINE_SIZE) +
+                    getArenaFootprint(sizeof(sample_t) * config.ring_size, CACHE_LINE_SIZE);
+  }
 
-  if (!(timestamps = (f32_t*) malloc(sizeof(f32_t) * cycle_num)))
+  if (!initArena(arena_size, config.huge_pages))
   {
-    perror("Memory allocation failed!");
+    perror("Arena allocation failed!");
     exit(-5);
   }
+
+  if (config.huge_pages)
+    printf("# Arena: %llu KiB (%s) #\n", getArenaSize() / 1024u,
+           (getArenaBacking() == ARENA_BACKING_HUGETLB) ? "hugetlb" :
+           (getArenaBacking() == ARENA_BACKING_THP) ? "thp" : "pages");
+
+  for (i = 0; i < config.num_threads; i++)
+  {
+    tasks[i].id = i;
+    tasks[i].cpu = config.cpus[i];
+    tasks[i].priority = config.priorities[i];
+    tasks[i].cycle_time = config.cycle_times[i];
+    tasks[i].cycle_num = config.cycle_nums[i];
+    tasks[i].work = config.work[i];
+    tasks[i].cycle_interval.tv_sec = tasks[i].cycle_time / NSEC_PER_SEC;
+    tasks[i].cycle_interval.tv_nsec = tasks[i].cycle_time % NSEC_PER_SEC;
+
+    /* The working set is part of the arena, so it is prefaulted like every other buffer. */
+    working_set = NULL;
+    if ((config.working_sets[i] > 0u) &&
+        !(working_set = (u8_t*) allocArena(config.working_sets[i], CACHE_LINE_SIZE)))
+    {
+      perror("Memory allocation failed!");
+      exit(-5);
+    }
+
+    initWorkload(&tasks[i].workload, tasks[i].work, working_set, config.working_sets[i]);
+
+    /* In stats-only mode no sample is kept, so memory does not grow with the run. */
+    if (config.sample_mode == SAMPLE_MODE_BUFFER)
+    {
+      if (!(tasks[i].timestamps = (s64_t*) allocArena(sizeof(s64_t) * tasks[i].cycle_num, CACHE_LINE_SIZE)))
+      {
+        perror("Memory allocation failed!");
+        exit(-5);
+      }
+    }
+
+    /* In stream mode the samples are pushed to a ring and written by a writer. */
+    if (config.sample_mode == SAMPLE_MODE_STREAM)
+    {
+      if (!(tasks[i].ring = (sample_ring_t*) allocArena(sizeof(sample_ring_t), CACHE_LINE_SIZE)) ||
+          !initSampleRing(tasks[i].ring, config.ring_size,
+                          (sample_t*) allocArena(sizeof(sample_t) * config.ring_size, CACHE_LINE_SIZE)))
+      {
+        perror("Ring allocation failed!");
+        exit(-5);
+      }
+
+      if ((tasks[i].stream_file = openResultsFile(&tasks[i])) == NULL)
+      {
+        perror("Could not open results file");
+        exit(-5);
+      }
+
+      if (config.output_format == OUTPUT_FORMAT_TEXT)
+        fprintf(tasks[i].stream_file, "# Timestamps #\n");
+    }
+
+    /* Keep the statistics of each thread on their own cache lines.
+     * The arena is zeroed, so the reporter may read them before the thread starts.
+     */
+    if (!(tasks[i].stats = (sched_statistics_t*) allocArena(sizeof(sched_statistics_t), CACHE_LINE_SIZE)))
+    {
+      perror("Memory allocation failed!");
+      exit(-5);
+    }
+
+    if (config.interference &&
+        !(tasks[i].interference = (interference_t*) allocArena(sizeof(interference_t), CACHE_LINE_SIZE)))
+    {
+      perror("Memory allocation failed!");
+      exit(-5);
+    }
+
+    /* The first thread of each pair wakes the second, through a handoff they share. */
+    if (config.pingpong && ((i % 2u) == 0u) &&
+        (!(tasks[i].pingpong = (pingpong_t*) allocArena(sizeof(pingpong_t), CACHE_LINE_SIZE)) ||
+         !initPingPong(tasks[i].pingpong, config.pingpong_mode)))
+    {
+      perror("Handoff allocation failed!");
+      exit(-5);
+    }
+    else if (config.pingpong && ((i % 2u) != 0u))
+    {
+      tasks[i].pingpong = tasks[i - 1u].pingpong;
+      tasks[i].wakee = TRUE;
+    }
+  }
+
+  if (config.pingpong)
+    printf("# Ping-Pong: %s (%u pairs) #\n", getPingPongName(config.pingpong_mode), config.num_threads / 2u);
+
+  if (config.interference)
+    sampleInterference(TRUE);
 }
 
 void* MAIN_TASK(void* ptr)
 {
-  u32_t i;
+  task_context_t* task = (task_context_t*)ptr;
+  s64_t timestamp, latency, release, end;
+  u64_t i, missed;
 
-  /* Synchronize scheduler's timer. */
-  clock_gettime(CLOCK_MONOTONIC, &main_task_timer);
+  /* A deadline thread switches itself, since there is no attribute for it. */
+  if ((config.policy == SCHED_POLICY_DEADLINE) &&
+      !setDeadlinePolicy(getDeadlineRuntime(&config, task->id), getDeadlineDeadline(&config, task->id),
+                         task->cycle_time))
+  {
+    perror("Could not set SCHED_DEADLINE");
+    exit(-6);
+  }
+
+  /* Every thread has its own stack to prefault. */
+  prefaultStack();
 
-  initStatistics((f32_t)cycle_time, main_task_timer.tv_nsec);
+  /* The counters are per thread, so each thread opens its own. */
+  if (config.interference && !initInterference(task->interference, config.perf_counters, config.interference_threshold))
+    fprintf(stderr, "T:%2u Some perf_event counters are not available\n", task->id);
 
-  for (i = 0; i < cycle_num; i++)
+  /* Once every thread is ready, one of them sets the common start time. */
+  if (pthread_barrier_wait(&start_barrier) == PTHREAD_BARRIER_SERIAL_THREAD)
   {
+    clock_gettime(CLOCK_MONOTONIC, &task->main_task_timer);
+    start_time = timespecToNsec(&task->main_task_timer) + (s64_t)START_DELAY;
+  }
+  (void)pthread_barrier_wait(&start_barrier);
+
+  /* Synchronize scheduler's timer, with the threads aligned or spread over a cycle. */
+  if (config.phase_mode == PHASE_MODE_STAGGER)
+    nsecToTimespec(start_time + (s64_t)((task->cycle_time * task->id) / config.num_threads),
+                   &task->main_task_timer);
+  else
+    nsecToTimespec(start_time, &task->main_task_timer);
+
+  initStatistics(task->stats, (s64_t)task->cycle_time, timespecToNsec(&task->main_task_timer),
+                 config.bucket_width, config.track_wakeup);
+  setStatisticsOverhead(task->stats, subtracted_overhead);
+
+  /* The response time only tells something when the cycle does some work. */
+  if ((config.num_tasks > 0u) || hasWorkload(&task->workload))
+    setStatisticsResponse(task->stats);
+
+  waitForShot(&task->main_task_timer);
+
+  /* A cycle number of 0 runs the task until the run is stopped. */
+  for (i = 0; ((task->cycle_num == 0u) || (i < task->cycle_num)) && !isRunStopped(); i++)
+  {
+    /* Store the timestamp (right after waking up for the current shot) */
+    release = timespecToNsec(&task->main_task_timer);
+    timestamp = getTimestamp(task->stats, release);
+
+    /* Freeze the kernel trace at the first outlier. */
+    if (config.break_threshold > 0u)
+    {
+      latency = config.track_wakeup ? task->stats->wakeup.cur_error : task->stats->jitter.cur_error;
+      if (latency > (s64_t)config.break_threshold)
+      {
+        breakTrace(task->id, task->cpu, i, latency, timestamp);
+        stopRun(0);
+      }
+    }
+
+#ifndef STATS_ONLY
+    if (task->timestamps != NULL)
+      task->timestamps[i] = timestamp;
+    else if (task->ring != NULL)
+      (void)pushSample(task->ring, timestamp);
+#endif
+
+    /* Hand off to the other thread of the pair, which measures how long its wakeup takes. */
+    if (task->pingpong != NULL)
+      (void)signalPingPong(task->pingpong);
+
+    /* Run the work of the cycle, and check whether it finished before the next release. */
+    if (task->stats->track_response)
+    {
+      runWorkload(&task->workload);
+      end = finishCycle(task->stats, release);
+    }
+    else
+      end = timestamp;
+
+    /* The counters themselves are only read on a report and around an outlier. */
+    if (task->interference != NULL)
+      updateInterference(task->interference,
+                         config.track_wakeup ? task->stats->wakeup.cur_error : task->stats->jitter.cur_error,
+                         __atomic_load_n(&capture_request, __ATOMIC_RELAXED));
+
     /* Calculate next shot */
-    updateInterval(cycle_time);
+    updateInterval(&task->main_task_timer, &task->cycle_interval);
 
-    /* Store the timestamp */
-    timestamps[i] = getTimestamp();
+    /* An overrun either runs the missed cycles back to back, or skips their releases. */
+    missed = updateOverrun(task->stats, end, timespecToNsec(&task->main_task_timer),
+                           (config.overrun_policy == OVERRUN_POLICY_SKIP) ? TRUE : FALSE);
+    if ((missed > 0u) && (config.overrun_policy == OVERRUN_POLICY_SKIP))
+      nsecToTimespec(timespecToNsec(&task->main_task_timer) + ((s64_t)missed * (s64_t)task->cycle_time),
+                     &task->main_task_timer);
 
-    /* Sleep for the remaining duration */
-    (void)clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &main_task_timer, NULL);
+    /* Wait for the remaining duration */
+    waitForShot(&task->main_task_timer);
   }
 
-  FILE *file = fopen("timestamps.txt", "w");
+  task->cycles = i;
+  finishThread();
+
+  /* The wakee waits for no more handoffs. */
+  if (task->pingpong != NULL)
+    closePingPong(task->pingpong);
 
-  if (file != NULL)
+  if (task->interference != NULL)
+    closeInterference(task->interference);
+
+  return (void*)NULL;
+}
+
+void* WAKEE_TASK(void* ptr)
+{
+  task_context_t* task = (task_context_t*)ptr;
+  s64_t timestamp, stamp;
+  u64_t i;
+
+  prefaultStack();
+
+  if (config.interference && !initInterference(task->interference, config.perf_counters, config.interference_threshold))
+    fprintf(stderr, "T:%2u Some perf_event counters are not available\n", task->id);
+
+  if (pthread_barrier_wait(&start_barrier) == PTHREAD_BARRIER_SERIAL_THREAD)
   {
-    printStatistics(NULL);  /* Print statistics to console */
-    printStatistics(file);  /* Print statistics to file */
+    clock_gettime(CLOCK_MONOTONIC, &task->main_task_timer);
+    start_time = timespecToNsec(&task->main_task_timer) + (s64_t)START_DELAY;
+  }
+  (void)pthread_barrier_wait(&start_barrier);
 
-    printf("\n# Timestamps #\n");
-    fprintf(file, "\n# Timestamps #\n");
+  /* The jitter is the spacing of the handoffs, which follow the cycles of the waker. */
+  initStatistics(task->stats, (s64_t)task->cycle_time, start_time, config.bucket_width, FALSE);
+  setStatisticsOverhead(task->stats, subtracted_overhead);
+  setStatisticsHandoff(task->stats);
 
-    for (i = 0; i < cycle_num; i++)
+  /* The waker closes the handoff once its cycles are done (or the run is stopped). */
+  for (i = 0; ((task->cycle_num == 0u) || (i < task->cycle_num)) && waitPingPong(task->pingpong, &stamp); i++)
+  {
+    timestamp = getHandoffTimestamp(task->stats, stamp);
+
+    /* The waker sees the stop, and closes the handoff. */
+    if ((config.break_threshold > 0u) && (task->stats->handoff.cur_error > (s64_t)config.break_threshold))
     {
-      printf("%.5f\n", timestamps[i]);
-      fprintf(file, "%.5f\n", timestamps[i]);
+      breakTrace(task->id, task->cpu, i, task->stats->handoff.cur_error, timestamp);
+      stopRun(0);
     }
 
-    fclose(file);
+#ifndef STATS_ONLY
+    if (task->timestamps != NULL)
+      task->timestamps[i] = timestamp;
+    else if (task->ring != NULL)
+      (void)pushSample(task->ring, timestamp);
+#endif
+
+    if (task->interference != NULL)
+      updateInterference(task->interference, task->stats->handoff.cur_error,
+                         __atomic_load_n(&capture_request, __ATOMIC_RELAXED));
+  }
+
+  task->cycles = i;
+  finishThread();
+
+  if (task->interference != NULL)
+    closeInterference(task->interference);
+
+  return (void*)NULL;
+}
+
+void* WRITER_TASK(void* ptr)
+{
+  struct timespec period = { 0, WRITER_PERIOD };
+  u8_t running;
+  u64_t total;
+  u32_t i;
+
+  (void)ptr;
+
+  do
+  {
+    /* Read the flag before draining, so that the last pass drains everything. */
+    running = __atomic_load_n(&writer_running, __ATOMIC_ACQUIRE);
+    total = 0u;
+
+    for (i = 0; i < config.num_threads; i++)
+      total += drainRing(&tasks[i]);
+
+    if ((total == 0u) && running)
+      (void)nanosleep(&period, NULL);
+  } while (running || (total > 0u));
+
+  return (void*)NULL;
+}
+
+void* REPORT_TASK(void* ptr)
+{
+  summary_thread_t summary;
+  struct timespec next;
+  s64_t start;
+  u32_t i;
+
+  (void)ptr;
+
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  start = timespecToNsec(&next);
+
+  pthread_mutex_lock(&report_lock);
+
+  while (reporter_running)
+  {
+    nsecToTimespec(timespecToNsec(&next) + (s64_t)config.report_interval, &next);
+
+    /* Sleep until the next report, or until the run ends. */
+    while (reporter_running && (pthread_cond_timedwait(&report_cond, &report_lock, &next) != ETIMEDOUT))
+      ;
+
+    if (!reporter_running)
+      break;
+
+    printf("\n# Report (%.1f s) #\n", (f64_t)(timespecToNsec(&next) - start) / NSEC_PER_SEC);
+
+    /* The measurement threads never wait for the snapshots. */
+    for (i = 0, report_sequence++; i < config.num_threads; i++)
+    {
+      readStatistics(tasks[i].stats, &report_snapshot);
+      printStatisticsSummary(&report_snapshot, tasks[i].id, tasks[i].cpu);
+
+      fillSummaryThread(&summary, &tasks[i], &report_snapshot);
+      exportSnapshot(&summary, config.num_threads, report_sequence, FALSE);
+    }
+
+    /* The interrupts at a breach are compared against the last report. */
+    if (config.break_threshold > 0u)
+      sampleTrace();
+
+    if (config.interference)
+    {
+      reportInterference();
+      (void)__atomic_add_fetch(&capture_request, 1u, __ATOMIC_RELAXED);
+    }
+
+    fflush(stdout);
   }
 
+  pthread_mutex_unlock(&report_lock);
+
   return (void*)NULL;
 }
 
 void EXIT_TASK(void)
 {
-  free(timestamps);
+  u32_t i;
+
+  /* Report after all threads are done, so that no thread is disturbed. */
+  if (config.num_threads > 1u)
+  {
+    printf("\n# Statistics #\n");
+
+    for (i = 0; i < config.num_threads; i++)
+      printStatisticsSummary(tasks[i].stats, tasks[i].id, tasks[i].cpu);
+  }
+
+  if (config.interference)
+    sampleInterference(FALSE);
+
+  writeSummaries();
+
+  /* The final results tell the collector that the thread is done. */
+  for (i = 0; i < config.num_threads; i++)
+    exportSnapshot(&summary_threads[i], config.num_threads, report_sequence + 1u, TRUE);
+  closeExport();
+
+  for (i = 0; i < config.num_threads; i++)
+  {
+    writeResults(&tasks[i], config.num_threads == 1u);
+
+    if (tasks[i].ring != NULL)
+      fclose(tasks[i].stream_file);
+  }
+
+  for (i = 0; i < config.num_threads; i++)
+    if ((tasks[i].pingpong != NULL) && !tasks[i].wakee)
+      destroyPingPong(tasks[i].pingpong);
+
+  /* The interference lies next to the statistics of each thread. */
+  if (config.interference)
+  {
+    printf("\n# Interference #");
+
+    for (i = 0; i < config.num_threads; i++)
+      printInterference(tasks[i].interference, tasks[i].id, tasks[i].cpu);
+  }
+
+  freeArena();
+
+  if (config.break_threshold > 0u)
+  {
+    printTrace(NULL);
+    closeTrace();
+  }
+
+  if (config.tune)
+    restoreTuning();
 }
 
 /********************************** Main Entry *******************************/
@@ -177,9 +1154,19 @@ int main(int argc, char** argv)
 {
   cpu_set_t mask;
 
-  pthread_t thread_1;
-  pthread_attr_t attr_1;
-  struct sched_param parm_1;
+  pthread_attr_t attr;
+  pthread_condattr_t cond_attr;
+  struct sched_param parm;
+  struct sigaction action;
+  sigset_t signals;
+
+  u32_t i;
+  long cpu, num_cpus;
+
+  /***********************************/
+
+  /* Parse the arguments and allocate all buffers, before they are locked. */
+  INIT_TASK(argc, argv);
 
   /***********************************/
 
@@ -200,24 +1187,154 @@ int main(int argc, char** argv)
     exit(-3);
   }
 
+
   /***********************************/
 
-  INIT_TASK(argc, argv);
+  /* Only the main thread takes the signals, so that no other thread is interrupted. */
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
 
-  /***********************************/
+  sem_init(&stop_semaphore, 0, 0u);
+
+  /* A second signal kills the process, in case the threads do not stop (see stopRun). */
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = stopRun;
+  sigemptyset(&action.sa_mask);
+  sigaddset(&action.sa_mask, SIGINT);
+  sigaddset(&action.sa_mask, SIGTERM);
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
 
-  pthread_attr_init(&attr_1);
-  pthread_attr_getschedparam(&attr_1, &parm_1);
-  parm_1.sched_priority = TASK_PRIORITY;
-  pthread_attr_setschedpolicy(&attr_1, SCHED_RR);
-  pthread_attr_setschedparam(&attr_1, &parm_1);
+  /* Every thread is created with the signals blocked, so the start is waited for with them. */
+  if (config.start_at > 0u)
+    waitForStart(&signals);
 
-  (void)pthread_create(&thread_1, &attr_1, (void*)MAIN_TASK, (void*)NULL);
-  pthread_setschedparam(thread_1, SCHED_RR, &parm_1);
+  /* The writer is not real-time, and runs on the housekeeping CPU. */
+  if (config.sample_mode == SAMPLE_MODE_STREAM)
+  {
+    writer_running = TRUE;
+
+    pthread_attr_init(&attr);
+
+    if (config.writer_cpu >= 0)
+    {
+      CPU_ZERO(&mask);
+      CPU_SET(config.writer_cpu, &mask);
+      pthread_attr_setaffinity_np(&attr, sizeof(mask), &mask);
+    }
+
+    if (pthread_create(&writer_thread, &attr, WRITER_TASK, NULL) != 0)
+    {
+      perror("Could not create writer thread");
+      exit(-6);
+    }
+
+    pthread_attr_destroy(&attr);
+  }
+
+  /* The reporter is not real-time either, and sleeps on CLOCK_MONOTONIC. */
+  if (config.report_interval > 0u)
+  {
+    reporter_running = TRUE;
+
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&report_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    if (pthread_create(&reporter_thread, NULL, REPORT_TASK, NULL) != 0)
+    {
+      perror("Could not create reporter thread");
+      exit(-6);
+    }
+  }
+
+  pthread_barrier_init(&start_barrier, NULL, config.num_threads);
+  running_threads = config.num_threads;
+
+  /* The configured CPUs, as the kernel leaves out the offline ones of a mask. */
+  num_cpus = sysconf(_SC_NPROCESSORS_CONF);
+
+  /* The load is running before the first measured cycle. */
+  if (!startLoad(config.loads, config.num_loads, config.load_size))
+  {
+    perror("Could not start load threads");
+    exit(-6);
+  }
+
+  for (i = 0; i < config.num_threads; i++)
+  {
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, TASK_STACK_SIZE);
+
+    /* Without explicit scheduling the attributes are silently ignored. */
+    if (config.policy != SCHED_POLICY_DEADLINE)
+    {
+      pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+      pthread_attr_getschedparam(&attr, &parm);
+      parm.sched_priority = tasks[i].priority;
+      pthread_attr_setschedpolicy(&attr, getSchedPolicyId(config.policy));
+      pthread_attr_setschedparam(&attr, &parm);
+
+      CPU_ZERO(&mask);
+      CPU_SET(tasks[i].cpu, &mask);
+      pthread_attr_setaffinity_np(&attr, sizeof(mask), &mask);
+    }
+    else
+    {
+      /* The kernel only admits deadline threads that span their root domain,
+       * so the single CPU the main thread is pinned to must not be inherited. */
+      CPU_ZERO(&mask);
+      for (cpu = 0; (cpu < num_cpus) && (cpu < CPU_SETSIZE); cpu++)
+        CPU_SET(cpu, &mask);
+      pthread_attr_setaffinity_np(&attr, sizeof(mask), &mask);
+    }
+
+    if ((errno = pthread_create(&tasks[i].thread, &attr, tasks[i].wakee ? WAKEE_TASK : MAIN_TASK,
+                                (void*)&tasks[i])) != 0)
+    {
+      perror("Could not create thread");
+      exit(-6);
+    }
+
+    pthread_attr_destroy(&attr);
+  }
+
+  pthread_sigmask(SIG_UNBLOCK, &signals, NULL);
+
+  if (config.duration > 0u)
+    waitForDuration();
 
   /***********************************/
 
-  pthread_join(thread_1, NULL);
+  for (i = 0; i < config.num_threads; i++)
+    pthread_join(tasks[i].thread, NULL);
+
+  /* The RT thread of the breach left its snapshot to be taken here. */
+  if (config.break_threshold > 0u)
+    collectTrace();
+
+  pthread_barrier_destroy(&start_barrier);
+  stopLoad();
+
+  if (config.report_interval > 0u)
+  {
+    pthread_mutex_lock(&report_lock);
+    reporter_running = FALSE;
+    pthread_cond_signal(&report_cond);
+    pthread_mutex_unlock(&report_lock);
+
+    pthread_join(reporter_thread, NULL);
+    pthread_cond_destroy(&report_cond);
+  }
+
+  if (config.sample_mode == SAMPLE_MODE_STREAM)
+  {
+    __atomic_store_n(&writer_running, FALSE, __ATOMIC_RELEASE);
+    pthread_join(writer_thread, NULL);
+  }
 
   EXIT_TASK();
 
@@ -0,0 +1,131 @@
+/**
+  * @file sample_file.c
+  * @brief Implements the writer and the memory mapped reader
+  *        of the binary sample file format.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+/******************************** Inclusions *********************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+
+#include "sample_file.h"
+#include "sched_statistics.h"
+
+/***************************** Public Functions ******************************/
+
+void initSampleFileHeader(sample_file_header_t* header, u64_t cycle_time,
+                          s32_t clock_id, u32_t cpu, u32_t priority)
+{
+  struct utsname name;
+
+  memset(header, 0, sizeof(*header));
+
+  memcpy(header->magic, SAMPLE_FILE_MAGIC, sizeof(header->magic));
+  header->version = SAMPLE_FILE_VERSION;
+  header->header_size = sizeof(*header);
+  header->record_size = sizeof(s64_t);
+  header->clock_id = clock_id;
+  header->cycle_time = cycle_time;
+  header->cpu = cpu;
+  header->priority = priority;
+
+  if (uname(&name) == 0)
+    (void)snprintf(header->kernel, sizeof(header->kernel), "%s", name.release);
+}
+
+u8_t writeSampleFileHeader(FILE* file, const sample_file_header_t* header)
+{
+  return (fwrite(header, sizeof(*header), 1u, file) == 1u) ? TRUE : FALSE;
+}
+
+u8_t writeSampleRecords(FILE* file, const s64_t* records, u64_t count)
+{
+  return (fwrite(records, sizeof(s64_t), count, file) == count) ? TRUE : FALSE;
+}
+
+u8_t mapSampleFile(const char* filename, sample_file_t* map)
+{
+  const sample_file_header_t* header;
+  struct stat st;
+  int fd;
+
+  memset(map, 0, sizeof(*map));
+
+  if ((fd = open(filename, O_RDONLY)) == -1)
+    return FALSE;
+
+  if ((fstat(fd, &st) == -1) || ((u64_t)st.st_size < sizeof(sample_file_header_t)))
+  {
+    close(fd);
+    return FALSE;
+  }
+
+  map->size = st.st_size;
+  map->base = mmap(NULL, map->size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (map->base == MAP_FAILED)
+  {
+    map->base = NULL;
+    return FALSE;
+  }
+
+  header = (const sample_file_header_t*)map->base;
+
+  if ((memcmp(header->magic, SAMPLE_FILE_MAGIC, sizeof(header->magic)) != 0) ||
+      (header->version != SAMPLE_FILE_VERSION) ||
+      (header->record_size != sizeof(s64_t)) ||
+      (header->header_size > map->size))
+  {
+    unmapSampleFile(map);
+    return FALSE;
+  }
+
+  /* The records are read front to back. */
+  (void)madvise(map->base, map->size, MADV_SEQUENTIAL);
+
+  map->header = header;
+  map->records = (const s64_t*)((const u8_t*)map->base + header->header_size);
+  map->count = (map->size - header->header_size) / header->record_size;
+
+  return TRUE;
+}
+
+void unmapSampleFile(sample_file_t* map)
+{
+  if (map->base != NULL)
+    (void)munmap(map->base, map->size);
+
+  memset(map, 0, sizeof(*map));
+}
+
+void printSampleFile(const sample_file_t* map, FILE* out)
+{
+  const sample_file_header_t* header = map->header;
+  u64_t i;
+
+  fprintf(out, "# Sample File #\n");
+  fprintf(out, "Version: %u\n", header->version);
+  fprintf(out, "Kernel: %.*s\n", (int)sizeof(header->kernel), header->kernel);
+  fprintf(out, "Clock: %d\n", header->clock_id);
+  fprintf(out, "CPU: %u\n", header->cpu);
+  fprintf(out, "Priority: %u\n", header->priority);
+  fprintf(out, "Cycle Time: %llu ns\n", header->cycle_time);
+  fprintf(out, "Samples: %llu\n", map->count);
+
+  fprintf(out, "\n# Timestamps #\n");
+
+  for (i = 0u; i < map->count; i++)
+    fprintf(out, "%lld.%09lld\n", map->records[i] / (s64_t)NSEC_PER_SEC, map->records[i] % (s64_t)NSEC_PER_SEC);
+}
@@ -0,0 +1,122 @@
+/**
+  * @file sample_file.h
+  * @brief Contains the binary sample file format and the declarations
+  *        of functions defined in sample_file.c.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+#ifndef SAMPLE_FILE_H
+#define SAMPLE_FILE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************** Inclusions *********************************/
+
+#include <stdio.h>
+
+#include "data_types.h"
+
+/***************************** Macro Definitions *****************************/
+
+/** The magic bytes every sample file starts with. */
+#define SAMPLE_FILE_MAGIC "RTSAMPLE"
+
+/** The version of the sample file format. */
+#define SAMPLE_FILE_VERSION (1u)
+
+/***************************** Type Definitions ******************************/
+
+/** The header of a sample file.
+  * It is followed by packed s64_t records, each being the timestamp
+  * of a sample in nsec. All fields are stored in host byte order.
+  * The header is 128 bytes, so that the records stay 8 byte aligned
+  * when the file is memory mapped.
+  */
+typedef struct
+{
+  char magic[8];       /**< SAMPLE_FILE_MAGIC (not NUL terminated). */
+  u32_t version;       /**< SAMPLE_FILE_VERSION. */
+  u32_t header_size;   /**< The offset of the first record. */
+  u32_t record_size;   /**< The size of each record. */
+  s32_t clock_id;      /**< The clock the timestamps were taken from. */
+  u64_t cycle_time;    /**< The cycle time of the task in nsec. */
+  u32_t cpu;           /**< The CPU the task was pinned to. */
+  u32_t priority;      /**< The priority of the task. */
+  char kernel[88];     /**< The release of the kernel the run was taken on. */
+} sample_file_header_t;
+
+/** A memory mapped sample file. */
+typedef struct
+{
+  const sample_file_header_t* header;  /**< The header of the file. */
+  const s64_t* records;                /**< The records of the file. */
+  u64_t count;                         /**< The number of records. */
+  void* base;                          /**< The base of the mapping. */
+  u64_t size;                          /**< The size of the mapping. */
+} sample_file_t;
+
+/***************************** Public Functions ******************************/
+
+/**
+  * @brief Fill the header of a sample file.
+  * @param header The header to fill.
+  * @param cycle_time The cycle time of the task in nsec.
+  * @param clock_id The clock the timestamps are taken from.
+  * @param cpu The CPU the task is pinned to.
+  * @param priority The priority of the task.
+  * @return Void.
+  */
+void initSampleFileHeader(sample_file_header_t* header, u64_t cycle_time,
+                          s32_t clock_id, u32_t cpu, u32_t priority);
+
+/**
+  * @brief Write the header of a sample file.
+  * @param file The file to write to.
+  * @param header The header to write.
+  * @return TRUE on success, FALSE otherwise.
+  */
+u8_t writeSampleFileHeader(FILE* file, const sample_file_header_t* header);
+
+/**
+  * @brief Append records to a sample file.
+  * @param file The file to write to.
+  * @param records The records to write.
+  * @param count The number of records.
+  * @return TRUE on success, FALSE otherwise.
+  */
+u8_t writeSampleRecords(FILE* file, const s64_t* records, u64_t count);
+
+/**
+  * @brief Memory map a sample file for reading.
+  * @param filename The path of the file.
+  * @param map The mapping to fill.
+  * @return TRUE on success, FALSE if the file could not be mapped or is invalid.
+  */
+u8_t mapSampleFile(const char* filename, sample_file_t* map);
+
+/**
+  * @brief Unmap a sample file.
+  * @param map The mapping to release.
+  * @return Void.
+  */
+void unmapSampleFile(sample_file_t* map);
+
+/**
+  * @brief Print the header and the records of a sample file as text.
+  * @param map The mapped file to print.
+  * @param out The stream to print to.
+  * @return Void.
+  */
+void printSampleFile(const sample_file_t* map, FILE* out);
+
+/*****************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* SAMPLE_FILE_H */
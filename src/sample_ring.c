@@ -0,0 +1,77 @@
+/**
+  * @file sample_ring.c
+  * @brief Implements a lock-free single-producer/single-consumer ring,
+  *        used to offload the samples of a measurement thread to a writer.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+/******************************** Inclusions *********************************/
+
+#include <string.h>
+
+#include "sample_ring.h"
+
+/***************************** Public Functions ******************************/
+
+u8_t initSampleRing(sample_ring_t* ring, u64_t size, sample_t* storage)
+{
+  if ((size == 0u) || ((size & (size - 1u)) != 0u) || (storage == NULL))
+    return FALSE;
+
+  memset(ring, 0, sizeof(*ring));
+
+  ring->samples = storage;
+  ring->mask = size - 1u;
+
+  return TRUE;
+}
+
+u8_t pushSample(sample_ring_t* ring, sample_t sample)
+{
+  u64_t head = ring->head;
+
+  if ((head - ring->cached_tail) > ring->mask)
+  {
+    ring->cached_tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    if ((head - ring->cached_tail) > ring->mask)
+    {
+      /* Relaxed, since the counter may be read while the run goes on. */
+      __atomic_store_n(&ring->dropped, ring->dropped + 1u, __ATOMIC_RELAXED);
+      return FALSE;
+    }
+  }
+
+  ring->samples[head & ring->mask] = sample;
+
+  /* Publish the sample only after it has been written. */
+  __atomic_store_n(&ring->head, head + 1u, __ATOMIC_RELEASE);
+
+  return TRUE;
+}
+
+u64_t popSamples(sample_ring_t* ring, sample_t* samples, u64_t max)
+{
+  u64_t tail = ring->tail;
+  u64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  u64_t count = head - tail;
+  u64_t i;
+
+  if (count > max)
+    count = max;
+
+  for (i = 0u; i < count; i++)
+    samples[i] = ring->samples[(tail + i) & ring->mask];
+
+  /* Release the slots only after they have been read. */
+  __atomic_store_n(&ring->tail, tail + count, __ATOMIC_RELEASE);
+
+  return count;
+}
+
+u64_t getDroppedSamples(const sample_ring_t* ring)
+{
+  return __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,95 @@
+/**
+  * @file sample_ring.h
+  * @brief Contains the declarations of functions defined in sample_ring.c.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************** Inclusions *********************************/
+
+#include "data_types.h"
+#include "sched_statistics.h"
+
+/***************************** Macro Definitions *****************************/
+
+/** The default number of samples a ring can hold (must be a power of 2). */
+#define DEFAULT_RING_SIZE (65536u)
+
+/***************************** Type Definitions ******************************/
+
+/** A compact sample, as pushed by a measurement thread (a timestamp in nsec). */
+typedef s64_t sample_t;
+
+/** A lock-free single-producer/single-consumer ring of samples.
+  * The indices of the producer and the consumer are kept on separate
+  * cache lines, so that the two sides never contend for the same line.
+  */
+typedef struct
+{
+  /* Written by the producer only. */
+  u64_t head __attribute__((aligned(CACHE_LINE_SIZE)));
+  u64_t cached_tail;  /**< The last tail seen by the producer. */
+  u64_t dropped;      /**< The samples dropped while the ring was full. */
+
+  /* Written by the consumer only. */
+  u64_t tail __attribute__((aligned(CACHE_LINE_SIZE)));
+
+  /* Read-only after initialization. */
+  u64_t mask __attribute__((aligned(CACHE_LINE_SIZE)));
+  sample_t* samples;
+} sample_ring_t;
+
+/***************************** Public Functions ******************************/
+
+/**
+  * @brief Initialize a ring over the given storage.
+  * @details The storage should already be prefaulted (e.g. carved out
+  *          of the arena), so that the producer never faults.
+  * @param ring The ring to initialize.
+  * @param size The number of samples the ring can hold (power of 2).
+  * @param storage The storage of the samples (size samples, cache line aligned).
+  * @return TRUE on success, FALSE if the size or the storage is invalid.
+  */
+u8_t initSampleRing(sample_ring_t* ring, u64_t size, sample_t* storage);
+
+/**
+  * @brief Push a sample to the ring (producer side).
+  * @details Never blocks and never enters the kernel. If the ring is full,
+  *          the sample is dropped and counted.
+  * @param ring The ring to push to.
+  * @param sample The sample to push.
+  * @return TRUE if the sample was pushed, FALSE if it was dropped.
+  */
+u8_t pushSample(sample_ring_t* ring, sample_t sample);
+
+/**
+  * @brief Pop the available samples from the ring (consumer side).
+  * @param ring The ring to pop from.
+  * @param samples The buffer to copy the samples to.
+  * @param max The maximum number of samples to pop.
+  * @return The number of samples popped.
+  */
+u64_t popSamples(sample_ring_t* ring, sample_t* samples, u64_t max);
+
+/**
+  * @brief Get the number of samples dropped by the producer.
+  * @param ring The ring to read.
+  * @return The number of dropped samples.
+  */
+u64_t getDroppedSamples(const sample_ring_t* ring);
+
+/*****************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* SAMPLE_RING_H */
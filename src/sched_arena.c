@@ -0,0 +1,137 @@
+/**
+  * @file sched_arena.c
+  * @brief Implements the arena every buffer of the RT path is carved from,
+  *        so that the sampling loop never touches a page it has not touched before.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+/******************************** Inclusions *********************************/
+
+#include <stdint.h>
+
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "sched_arena.h"
+
+/***************************** Static Variables ******************************/
+
+/** The mapping of the arena. */
+static u8_t* arena_base;
+static u64_t arena_size;
+
+/** The bytes already carved out of the arena. */
+static u64_t arena_used;
+
+/** The pages the arena is backed by. */
+static arena_backing_t arena_backing = ARENA_BACKING_PAGES;
+
+/************************ Static Function Prototypes *************************/
+
+/**
+  * @brief Round a size up to a multiple of a power of 2.
+  * @param size The size to round.
+  * @param align The power of 2 to round to.
+  * @return The rounded size.
+  */
+static u64_t roundUp(u64_t size, u64_t align);
+
+/***************************** Static Functions ******************************/
+
+u64_t roundUp(u64_t size, u64_t align)
+{
+  return (size + align - 1u) & ~(align - 1u);
+}
+
+/***************************** Public Functions ******************************/
+
+u8_t initArena(u64_t size, u8_t huge)
+{
+  const u64_t page_size = (u64_t)sysconf(_SC_PAGESIZE);
+  void* base = MAP_FAILED;
+  u64_t i, head, slack;
+
+  arena_backing = ARENA_BACKING_PAGES;
+  arena_used = 0u;
+
+  if (huge)
+  {
+    /* Reserved huge pages are only available if the admin set nr_hugepages. */
+    arena_size = roundUp(size, ARENA_HUGE_PAGE_SIZE);
+    base = mmap(NULL, arena_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (base != MAP_FAILED)
+      arena_backing = ARENA_BACKING_HUGETLB;
+  }
+
+  if (base == MAP_FAILED)
+  {
+    /* THP only backs the huge pages a mapping fully covers, so it is aligned to one. */
+    arena_size = roundUp(size, huge ? ARENA_HUGE_PAGE_SIZE : page_size);
+    slack = huge ? ARENA_HUGE_PAGE_SIZE : 0u;
+    base = mmap(NULL, arena_size + slack, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+      return FALSE;
+
+    /* The slack before and after the aligned arena is given back. */
+    if (huge)
+    {
+      head = roundUp((u64_t)(uintptr_t)base, ARENA_HUGE_PAGE_SIZE) - (u64_t)(uintptr_t)base;
+      if (head > 0u)
+        (void)munmap(base, head);
+      if (slack > head)
+        (void)munmap((u8_t*)base + head + arena_size, slack - head);
+      base = (u8_t*)base + head;
+    }
+
+    if (huge && (madvise(base, arena_size, MADV_HUGEPAGE) == 0))
+      arena_backing = ARENA_BACKING_THP;
+  }
+
+  arena_base = (u8_t*)base;
+
+  /* Write every page, so that it is mapped (and zeroed) before the run. */
+  for (i = 0u; i < arena_size; i += page_size)
+    arena_base[i] = 0u;
+
+  return TRUE;
+}
+
+void* allocArena(u64_t size, u64_t align)
+{
+  const u64_t start = roundUp(arena_used, align);
+
+  if ((arena_base == NULL) || (start + size > arena_size))
+    return NULL;
+
+  arena_used = start + size;
+
+  return arena_base + start;
+}
+
+u64_t getArenaFootprint(u64_t size, u64_t align)
+{
+  return size + align - 1u;
+}
+
+arena_backing_t getArenaBacking(void)
+{
+  return arena_backing;
+}
+
+u64_t getArenaSize(void)
+{
+  return arena_size;
+}
+
+void freeArena(void)
+{
+  if (arena_base != NULL)
+    (void)munmap(arena_base, arena_size);
+
+  arena_base = NULL;
+  arena_size = arena_used = 0u;
+}
@@ -0,0 +1,88 @@
+/**
+  * @file sched_arena.h
+  * @brief Contains the declarations of functions defined in sched_arena.c.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+#ifndef SCHED_ARENA_H
+#define SCHED_ARENA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************** Inclusions *********************************/
+
+#include "data_types.h"
+
+/***************************** Macro Definitions *****************************/
+
+/** The size of a huge page the arena is rounded up to, if backed by huge pages. */
+#define ARENA_HUGE_PAGE_SIZE (2u * 1024u * 1024u)
+
+/***************************** Type Definitions ******************************/
+
+/** The pages the arena is backed by. */
+typedef enum
+{
+  ARENA_BACKING_PAGES,    /**< Normal pages. */
+  ARENA_BACKING_THP,      /**< Normal pages, advised to be merged into transparent huge pages. */
+  ARENA_BACKING_HUGETLB   /**< Huge pages reserved through hugetlbfs. */
+} arena_backing_t;
+
+/***************************** Public Functions ******************************/
+
+/**
+  * @brief Map and prefault the arena every buffer of the RT path is carved from.
+  * @details Every page is written before the run, so that the measurement
+  *          threads never take a page fault. The memory is zeroed.
+  *          Huge pages are tried through MAP_HUGETLB first, then through THP.
+  * @param size The size of the arena in bytes.
+  * @param huge Back the arena by huge pages if possible.
+  * @return TRUE on success, FALSE if the arena could not be mapped.
+  */
+u8_t initArena(u64_t size, u8_t huge);
+
+/**
+  * @brief Carve a buffer out of the arena.
+  * @param size The size of the buffer in bytes.
+  * @param align The alignment of the buffer (power of 2).
+  * @return The buffer, NULL if the arena is exhausted.
+  */
+void* allocArena(u64_t size, u64_t align);
+
+/**
+  * @brief Get the size that a buffer takes in the arena, in the worst case.
+  * @param size The size of the buffer in bytes.
+  * @param align The alignment of the buffer (power of 2).
+  * @return The size including the alignment padding.
+  */
+u64_t getArenaFootprint(u64_t size, u64_t align);
+
+/**
+  * @brief Get the pages the arena is backed by.
+  * @return The backing of the arena.
+  */
+arena_backing_t getArenaBacking(void);
+
+/**
+  * @brief Get the size of the arena.
+  * @return The size of the arena in bytes.
+  */
+u64_t getArenaSize(void);
+
+/**
+  * @brief Unmap the arena (every buffer carved out of it is freed).
+  * @return Void.
+  */
+void freeArena(void);
+
+/*****************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* SCHED_ARENA_H */
@@ -0,0 +1,135 @@
+/**
+  * @file sched_calibration.c
+  * @brief Implements the calibration of the measurement overhead,
+  *        i.e. how much of the measured latency is the cost of measuring it.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+/******************************** Inclusions *********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sched_calibration.h"
+
+/***************************** Macro Definitions *****************************/
+
+/** The width of a histogram bucket of the overhead in nsec. */
+#define CALIBRATION_BUCKET_WIDTH (1u)
+
+/** The cycle time given to the scratch statistics (only its cost matters). */
+#define CALIBRATION_CYCLE_TIME (NSEC_PER_MSEC)
+
+/***************************** Static Variables ******************************/
+
+/** The statistics the sample path is calibrated with (too large for the stack). */
+static sched_statistics_t scratch_statistics;
+
+/************************ Static Function Prototypes *************************/
+
+/**
+  * @brief Print the overhead of one path as a single line.
+  * @param out The stream to print to.
+  * @param latency The overhead of the path.
+  * @param name The name of the path.
+  * @return Void.
+  */
+static void printPath(FILE* out, const latency_statistics_t* latency, const char* name);
+
+/**
+  * @brief Compare two clock reads (for qsort).
+  * @param first The first read.
+  * @param second The second read.
+  * @return Less than, equal to or greater than 0 as the first is shorter, as long as or longer than the second.
+  */
+static int compareReads(const void* first, const void* second);
+
+/***************************** Static Functions ******************************/
+
+void printPath(FILE* out, const latency_statistics_t* latency, const char* name)
+{
+  fprintf(out, "%s: Min: %lld ns P50: %lld ns P99: %lld ns Max: %lld ns Avg: %.1f ns\n",
+          name,
+          (latency->number_of_calls > 0u) ? latency->min_error : 0,
+          getPercentile(latency, 50.0), getPercentile(latency, 99.0),
+          latency->max_error, getAverageError(latency));
+}
+
+int compareReads(const void* first, const void* second)
+{
+  const s64_t a = *(const s64_t*)first;
+  const s64_t b = *(const s64_t*)second;
+
+  return (a > b) - (a < b);
+}
+
+/***************************** Public Functions ******************************/
+
+u8_t calibrateOverhead(overhead_statistics_t* overhead, clock_source_t source, u32_t loops)
+{
+  s64_t before, after;
+  s64_t* reads;
+  u32_t i;
+
+  overhead->source = source;
+  overhead->median = 0;
+  initLatency(&overhead->clock_read, CALIBRATION_BUCKET_WIDTH);
+  initLatency(&overhead->sample_path, CALIBRATION_BUCKET_WIDTH);
+
+  if ((loops == 0u) || !initClock(source))
+    return FALSE;
+
+  /* The reads are kept, as a slow clock falls past the range of the histogram. */
+  if ((reads = (s64_t*)malloc(sizeof(*reads) * loops)) == NULL)
+    return FALSE;
+
+  /* Two back-to-back reads are one read apart. */
+  for (i = 0u; i < loops; i++)
+  {
+    before = getClockNsec();
+    after = getClockNsec();
+    reads[i] = after - before;
+  }
+
+  for (i = 0u; i < loops; i++)
+    updateLatency(&overhead->clock_read, reads[i]);
+
+  qsort(reads, loops, sizeof(*reads), compareReads);
+  overhead->median = reads[loops / 2u];
+  free(reads);
+
+  initStatistics(&scratch_statistics, CALIBRATION_CYCLE_TIME, getClockNsec(),
+                 CALIBRATION_BUCKET_WIDTH, TRUE);
+
+  /* The sample path includes its own clock read and both histogram updates. */
+  for (i = 0u; i < loops; i++)
+  {
+    before = getClockNsec();
+    (void)getTimestamp(&scratch_statistics, before);
+    after = getClockNsec();
+    updateLatency(&overhead->sample_path, after - before);
+  }
+
+  return TRUE;
+}
+
+s64_t getMedianOverhead(const overhead_statistics_t* overhead)
+{
+  return overhead->median;
+}
+
+void printOverhead(const overhead_statistics_t* overhead, FILE* file)
+{
+  FILE* out = (file == NULL) ? stdout : file;
+
+  if (file == NULL)
+    fprintf(out, "\n");
+
+  fprintf(out, "# Overhead (%s) #\n",
+          (overhead->source == CLOCK_SOURCE_COUNTER) ? "counter" : "monotonic");
+  printPath(out, &overhead->clock_read, "Clock Read");
+  fprintf(out, "Median Read: %lld ns\n", overhead->median);
+  printPath(out, &overhead->sample_path, "Sample Path");
+}
@@ -0,0 +1,74 @@
+/**
+  * @file sched_calibration.h
+  * @brief Contains the declarations of functions defined in sched_calibration.c.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+#ifndef SCHED_CALIBRATION_H
+#define SCHED_CALIBRATION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************** Inclusions *********************************/
+
+#include <stdio.h>
+
+#include "data_types.h"
+#include "sched_statistics.h"
+#include "sched_clock.h"
+
+/***************************** Macro Definitions *****************************/
+
+/** The default number of back-to-back calls of each calibrated path. */
+#define DEFAULT_CALIBRATION_LOOPS (100000u)
+
+/***************************** Type Definitions ******************************/
+
+/** The measured overhead of a clock backend. */
+typedef struct
+{
+  clock_source_t source;             /**< The clock backend that was calibrated. */
+  latency_statistics_t clock_read;   /**< The cost of reading the clock. */
+  latency_statistics_t sample_path;  /**< The cost of a timestamp, including the statistics update. */
+  s64_t median;                      /**< The exact median cost of reading the clock in nsec. */
+} overhead_statistics_t;
+
+/***************************** Public Functions ******************************/
+
+/**
+  * @brief Measure the overhead of the sampling path with a clock backend.
+  * @details The backend is selected for the calibration, so initClock
+  *          has to be called again for the backend of the actual run.
+  * @param overhead The overhead to measure.
+  * @param source The clock backend to calibrate.
+  * @param loops The number of back-to-back calls of each path.
+  * @return TRUE on success, FALSE if the backend is not supported (or the reads could not be kept).
+  */
+u8_t calibrateOverhead(overhead_statistics_t* overhead, clock_source_t source, u32_t loops);
+
+/**
+  * @brief Get the overhead to subtract from the results.
+  * @param overhead The measured overhead.
+  * @return The median cost of reading the clock in nsec (sorted from every read, not the histogram).
+  */
+s64_t getMedianOverhead(const overhead_statistics_t* overhead);
+
+/**
+  * @brief Print the measured overhead to file/console.
+  * @param overhead The overhead to print.
+  * @param file The file to print to. Print to console if NULL.
+  * @return Void.
+  */
+void printOverhead(const overhead_statistics_t* overhead, FILE* file);
+
+/*****************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* SCHED_CALIBRATION_H */
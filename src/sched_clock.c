@@ -0,0 +1,272 @@
+/**
+  * @file sched_clock.c
+  * @brief Implements the clocks the timestamps are taken from,
+  *        including a raw counter backend calibrated against CLOCK_MONOTONIC.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+/******************************** Inclusions *********************************/
+
+#include <time.h>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#include "sched_clock.h"
+#include "sched_statistics.h"
+
+/***************************** Macro Definitions *****************************/
+
+/** The raw counter is only supported where it can be read from user space
+  * and 128-bit multiplications are cheap (and not compiled out).
+  */
+#if (defined(__x86_64__) || defined(__aarch64__)) && !defined(MONOTONIC_CLOCK_ONLY)
+#define COUNTER_SUPPORTED
+#endif
+
+#if defined(COUNTER_CLOCK_ONLY) && !defined(COUNTER_SUPPORTED)
+#error "The raw counter is not supported on this architecture"
+#endif
+
+/** The fixed point shift of the counter to nsec multiplier. */
+#define COUNTER_SHIFT (32u)
+
+/** The time the counter is calibrated for (in nsec). */
+#define CALIBRATION_TIME (200u * NSEC_PER_MSEC)
+
+/** The number of tries to read both clocks within the shortest window. */
+#define CALIBRATION_TRIES (16u)
+
+/** The CPUID bits of rdtscp (leaf 0x80000001) and of the invariant TSC (leaf 0x80000007) in EDX. */
+#define CPUID_EDX_RDTSCP (1u << 27)
+#define CPUID_EDX_INVARIANT_TSC (1u << 8)
+
+/***************************** Static Variables ******************************/
+
+/** The selected clock (read-only after initialization). */
+static clock_source_t clock_source = DEFAULT_CLOCK_SOURCE;
+
+#ifdef COUNTER_SUPPORTED
+
+/** The counter value and the time it was read at. */
+static u64_t base_counter;
+static s64_t base_nsec;
+
+/** The nsec per counter tick, in fixed point. */
+static u64_t counter_mult;
+
+/** The frequency of the counter in Hz. */
+static u64_t counter_frequency;
+
+#endif
+
+/************************ Static Function Prototypes *************************/
+
+/**
+  * @brief Read CLOCK_MONOTONIC in nsec.
+  * @return The current time in nsec.
+  */
+static s64_t readMonotonic(void);
+
+#ifdef COUNTER_SUPPORTED
+
+/**
+  * @brief Read the raw counter of the CPU.
+  * @return The current counter value.
+  */
+static u64_t readCounter(void);
+
+/**
+  * @brief Read the counter and CLOCK_MONOTONIC at (almost) the same time.
+  * @param counter The counter value.
+  * @param nsec The time in nsec.
+  * @return Void.
+  */
+static void readClocks(u64_t* counter, s64_t* nsec);
+
+/**
+  * @brief Check whether the counter ticks at a constant rate, in sync on every core.
+  * @details The TSC of x86 only does when it is invariant (it neither stops in
+  *          deep C-states nor follows the frequency), which the timestamps
+  *          of different cores (e.g. of a ping-pong handoff) rely on.
+  *          The generic timer of ARMv8 always is.
+  * @return TRUE if the counter can be used, FALSE otherwise.
+  */
+static u8_t isCounterInvariant(void);
+
+/**
+  * @brief Get the frequency of the counter, calibrating it if needed.
+  * @details The base counter value and time should already be read.
+  * @return The frequency in Hz, 0 if the calibration failed.
+  */
+static u64_t calibrateCounter(void);
+
+#endif
+
+/***************************** Static Functions ******************************/
+
+s64_t readMonotonic(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return timespecToNsec(&now);
+}
+
+#ifdef COUNTER_SUPPORTED
+
+u64_t readCounter(void)
+{
+#if defined(__x86_64__)
+  u32_t low, high, aux;
+
+  /* rdtscp waits for all previous instructions to execute. */
+  __asm__ __volatile__("rdtscp" : "=a"(low), "=d"(high), "=c"(aux) : : "memory");
+
+  return ((u64_t)high << 32) | low;
+#else
+  u64_t counter;
+
+  __asm__ __volatile__("isb; mrs %0, cntvct_el0" : "=r"(counter) : : "memory");
+
+  return counter;
+#endif
+}
+
+void readClocks(u64_t* counter, s64_t* nsec)
+{
+  u64_t before, after, window = U64_MAX;
+  s64_t now;
+  u32_t i;
+
+  for (i = 0u; i < CALIBRATION_TRIES; i++)
+  {
+    before = readCounter();
+    now = readMonotonic();
+    after = readCounter();
+
+    if ((after - before) < window)
+    {
+      window = after - before;
+      *counter = before + (window / 2u);
+      *nsec = now;
+    }
+  }
+}
+
+u8_t isCounterInvariant(void)
+{
+#if defined(__x86_64__)
+  u32_t eax, ebx, ecx, edx;
+
+  /* __get_cpuid checks that the extended leaf is supported first. */
+  if (!__get_cpuid(0x80000001u, &eax, &ebx, &ecx, &edx) || !(edx & CPUID_EDX_RDTSCP))
+    return FALSE;
+
+  if (!__get_cpuid(0x80000007u, &eax, &ebx, &ecx, &edx) || !(edx & CPUID_EDX_INVARIANT_TSC))
+    return FALSE;
+
+  return TRUE;
+#else
+  return TRUE;
+#endif
+}
+
+u64_t calibrateCounter(void)
+{
+#if defined(__aarch64__)
+  u64_t frequency;
+
+  /* The generic timer reports its own frequency. */
+  __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(frequency));
+
+  return frequency;
+#else
+  struct timespec delay;
+  u64_t end_counter;
+  s64_t end_nsec;
+
+  nsecToTimespec(CALIBRATION_TIME, &delay);
+  (void)nanosleep(&delay, NULL);
+
+  readClocks(&end_counter, &end_nsec);
+
+  if ((end_counter <= base_counter) || (end_nsec <= base_nsec))
+    return 0u;
+
+  return (u64_t)(((unsigned __int128)(end_counter - base_counter) * NSEC_PER_SEC) /
+                 (u64_t)(end_nsec - base_nsec));
+#endif
+}
+
+#endif
+
+/***************************** Public Functions ******************************/
+
+u8_t initClock(clock_source_t source)
+{
+#ifdef COUNTER_CLOCK_ONLY
+  if (source == CLOCK_SOURCE_MONOTONIC)
+    return FALSE;
+#else
+  clock_source = CLOCK_SOURCE_MONOTONIC;
+
+  if (source == CLOCK_SOURCE_MONOTONIC)
+    return TRUE;
+#endif
+
+#ifdef COUNTER_SUPPORTED
+  if (!isCounterInvariant())
+    return FALSE;
+
+  readClocks(&base_counter, &base_nsec);
+
+  if ((counter_frequency = calibrateCounter()) == 0u)
+    return FALSE;
+
+  counter_mult = (u64_t)(((unsigned __int128)NSEC_PER_SEC << COUNTER_SHIFT) / counter_frequency);
+  clock_source = CLOCK_SOURCE_COUNTER;
+
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+s64_t getClockNsec(void)
+{
+#if defined(COUNTER_CLOCK_ONLY)
+  return base_nsec + (s64_t)(((unsigned __int128)(readCounter() - base_counter) * counter_mult) >> COUNTER_SHIFT);
+#else
+#ifdef COUNTER_SUPPORTED
+  if (clock_source == CLOCK_SOURCE_COUNTER)
+    return base_nsec + (s64_t)(((unsigned __int128)(readCounter() - base_counter) * counter_mult) >> COUNTER_SHIFT);
+#endif
+
+  return readMonotonic();
+#endif
+}
+
+s32_t getClockId(void)
+{
+  return (clock_source == CLOCK_SOURCE_COUNTER) ? CLOCK_ID_COUNTER : CLOCK_MONOTONIC;
+}
+
+const char* getClockName(void)
+{
+  return (clock_source == CLOCK_SOURCE_COUNTER) ? "counter" : "monotonic";
+}
+
+u64_t getCounterFrequency(void)
+{
+#ifdef COUNTER_SUPPORTED
+  if (clock_source == CLOCK_SOURCE_COUNTER)
+    return counter_frequency;
+#endif
+
+  return 0u;
+}
@@ -0,0 +1,92 @@
+/**
+  * @file sched_clock.h
+  * @brief Contains the declarations of functions defined in sched_clock.c.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+#ifndef SCHED_CLOCK_H
+#define SCHED_CLOCK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************** Inclusions *********************************/
+
+#include "data_types.h"
+
+/***************************** Type Definitions ******************************/
+
+/** The clocks the timestamps can be taken from. */
+typedef enum
+{
+  CLOCK_SOURCE_MONOTONIC,  /**< clock_gettime(CLOCK_MONOTONIC), through the vDSO if possible. */
+  CLOCK_SOURCE_COUNTER     /**< The raw counter of the CPU (TSC on x86, CNTVCT_EL0 on ARMv8). */
+} clock_source_t;
+
+/***************************** Macro Definitions *****************************/
+
+/** A build may take the timestamps from one clock only (see the Makefile),
+  * so that reading the time needs no branch.
+  */
+#if defined(MONOTONIC_CLOCK_ONLY) && defined(COUNTER_CLOCK_ONLY)
+#error "MONOTONIC_CLOCK_ONLY and COUNTER_CLOCK_ONLY are exclusive"
+#endif
+
+/** The clock the timestamps are taken from, unless given. */
+#ifdef COUNTER_CLOCK_ONLY
+#define DEFAULT_CLOCK_SOURCE (CLOCK_SOURCE_COUNTER)
+#else
+#define DEFAULT_CLOCK_SOURCE (CLOCK_SOURCE_MONOTONIC)
+#endif
+
+/** The clock id recorded for timestamps taken from the raw counter. */
+#define CLOCK_ID_COUNTER (-1)
+
+/***************************** Public Functions ******************************/
+
+/**
+  * @brief Initialize the clock the timestamps are taken from.
+  * @details The raw counter is calibrated against CLOCK_MONOTONIC,
+  *          so that both clocks give timestamps in the same time base.
+  *          Since the calibration has a finite accuracy, timestamps of the
+  *          counter slowly drift from CLOCK_MONOTONIC over long runs.
+  *          On x86 the counter is refused without an invariant TSC.
+  * @param source The clock to use.
+  * @return TRUE on success, FALSE if the clock is not supported.
+  */
+u8_t initClock(clock_source_t source);
+
+/**
+  * @brief Get the current time from the selected clock.
+  * @return The current time in nsec (in the CLOCK_MONOTONIC time base).
+  */
+s64_t getClockNsec(void);
+
+/**
+  * @brief Get the id of the selected clock, as recorded in sample files.
+  * @return CLOCK_MONOTONIC or CLOCK_ID_COUNTER.
+  */
+s32_t getClockId(void);
+
+/**
+  * @brief Get the name of the selected clock.
+  * @return The name of the clock.
+  */
+const char* getClockName(void);
+
+/**
+  * @brief Get the frequency of the raw counter.
+  * @return The frequency in Hz, 0 if the counter is not used.
+  */
+u64_t getCounterFrequency(void);
+
+/*****************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* SCHED_CLOCK_H */
@@ -0,0 +1,923 @@
+/**
+  * @file sched_config.c
+  * @brief Implements the command line parsing of a test run.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+/******************************** Inclusions *********************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <sched.h>
+#include <getopt.h>
+
+#include "sched_config.h"
+#include "sched_calibration.h"
+#include "sample_ring.h"
+#include "sched_export.h"
+
+/***************************** Macro Definitions *****************************/
+
+/** The identifiers of the options that only have a long form. */
+#define OPT_BUCKET_WIDTH (256)
+#define OPT_RING_SIZE    (257)
+#define OPT_WRITER_CPU   (258)
+#define OPT_DUMP         (259)
+#define OPT_WAIT         (260)
+#define OPT_SPIN_MARGIN  (261)
+#define OPT_CLOCK        (262)
+#define OPT_CALIBRATE    (263)
+#define OPT_SUBTRACT     (264)
+#define OPT_LOAD         (265)
+#define OPT_LOAD_SIZE    (266)
+#define OPT_REPORT       (267)
+#define OPT_JSON         (268)
+#define OPT_CSV          (269)
+#define OPT_HUGE_PAGES   (270)
+#define OPT_PHASE        (271)
+#define OPT_POLICY       (272)
+#define OPT_DL_RUNTIME   (273)
+#define OPT_DL_DEADLINE  (274)
+#define OPT_TASK         (275)
+#define OPT_WORK         (276)
+#define OPT_WORKING_SET  (277)
+#define OPT_OVERRUN      (278)
+#define OPT_INTERFERENCE (279)
+#define OPT_PREFLIGHT    (280)
+#define OPT_TUNE         (281)
+#define OPT_PINGPONG     (282)
+#define OPT_REPORT_TO    (283)
+#define OPT_START_AT     (284)
+#define OPT_NODE_NAME    (285)
+#define OPT_INTERFERENCE_THRESHOLD (286)
+
+/** Marks the work or working set of a task that was not given (the default applies). */
+#define UNSET_WORK (U64_MAX)
+
+/************************ Static Function Prototypes *************************/
+
+/**
+  * @brief Print the usage of the program and exit with an error.
+  * @param program The name of the program.
+  * @return Void.
+  */
+static void printUsage(const char* program);
+
+/**
+  * @brief Parse a duration with an optional unit suffix ("ns", "us", "ms" or "s").
+  * @param arg The string to parse.
+  * @param unit The unit of a duration without suffix in nsec.
+  * @param nsec The parsed duration in nsec.
+  * @return TRUE on success, FALSE if the duration is invalid.
+  */
+static u8_t parseDuration(const char* arg, u64_t unit, u64_t* nsec);
+
+/**
+  * @brief Parse a CPU list of the form "0,2-3".
+  * @param list The string to parse.
+  * @param cpus The array to store the CPUs to.
+  * @param max The maximum number of CPUs to store.
+  * @return The number of CPUs stored, 0 if the list is invalid.
+  */
+static u32_t parseCpuList(const char* list, u32_t* cpus, u32_t max);
+
+/**
+  * @brief Parse a size with an optional binary suffix ("K", "M" or "G").
+  * @param arg The string to parse.
+  * @param bytes The parsed size in bytes.
+  * @return TRUE on success, FALSE if the size is invalid.
+  */
+static u8_t parseSize(const char* arg, u64_t* bytes);
+
+/**
+  * @brief Parse a background load of the form "TYPE:LIST" (e.g. memcpy:2-3).
+  * @param arg The string to parse.
+  * @param config The configuration to add one load thread per listed CPU to.
+  * @return TRUE on success, FALSE if the load is invalid.
+  */
+static u8_t parseLoad(const char* arg, sched_config_t* config);
+
+/**
+  * @brief Parse a task of a task set of the form "PERIOD:PRIORITY:CPU[:WORK[:SIZE]]"
+  *        (e.g. 5ms:70:1:500us:256K).
+  * @param arg The string to parse.
+  * @param config The configuration to add a measurement thread to.
+  * @return TRUE on success, FALSE if the task is invalid.
+  */
+static u8_t parseTask(const char* arg, sched_config_t* config);
+
+/***************************** Static Functions ******************************/
+
+void printUsage(const char* program)
+{
+  fprintf(stderr,
+          "Usage: %s [options] [cycle_time] [number_of_cycles]\n"
+          "       %s [options] --task PERIOD:PRIORITY:CPU[:WORK[:SIZE]]... [number_of_cycles]\n"
+          "  cycle_time             The cycle time of each task, in msec unless\n"
+          "                         suffixed with ns, us, ms or s (e.g. 50us).\n"
+          "  number_of_cycles       The number of cycles each task runs for (0 runs until\n"
+          "                         stopped, not with the default buffering). May be omitted\n"
+          "                         with --duration. SIGINT/SIGTERM stop the run early.\n"
+          "Options:\n"
+          "  -t, --threads NUM      Spawn NUM measurement threads.\n"
+          "  -a, --affinity LIST    Pin the threads to the CPUs in LIST (e.g. 0,2-3).\n"
+          "      --policy POLICY    Schedule the threads with fifo, rr (default) or deadline\n"
+          "                         (deadline threads span all CPUs, see sched_setattr).\n"
+          "  -p, --priority LIST    The priority of each thread (e.g. 49,48, default: %u).\n"
+          "      --dl-runtime T     The runtime of each deadline period, in nsec unless\n"
+          "                         suffixed (default: a tenth of the cycle time).\n"
+          "      --dl-deadline T    The relative deadline of each deadline period, in nsec\n"
+          "                         unless suffixed (default: the cycle time).\n"
+          "  -D, --duration T       Stop the run after T, in sec unless suffixed.\n"
+          "      --bucket-width T   The width of a histogram bucket, in nsec unless\n"
+          "                         suffixed (default: %uns).\n"
+          "      --clock CLOCK      Take the timestamps from the monotonic clock (default)\n"
+          "                         or the raw CPU counter (TSC/CNTVCT_EL0).\n"
+          "      --calibrate[=NUM]  Measure the overhead of each clock with NUM loops\n"
+          "                         before the run (default: %u).\n"
+          "      --subtract-overhead\n"
+          "                         Subtract the median overhead from the wakeup latency.\n"
+          "      --wait MODE        Wait for each shot with sleep (default), spin or hybrid.\n"
+          "      --spin-margin T    The time spun before each deadline in hybrid mode,\n"
+          "                         in nsec unless suffixed (default: %uus).\n"
+          "      --phase MODE       Start the threads at the same deadlines (align, default)\n"
+          "                         or spread them evenly over a cycle (stagger).\n"
+          "  -W, --wakeup           Also measure the wakeup latency against each deadline.\n"
+          "  -b, --breaktrace T     Stop ftrace and the run, and record the interrupts once\n"
+          "                         a latency (the wakeup latency with -W) exceeds T, in\n"
+          "                         usec unless suffixed.\n"
+          "  -s, --stats-only       Keep only the statistics, not every timestamp.\n"
+          "  -r, --stream           Stream the timestamps to a non-RT writer thread.\n"
+          "      --ring-size NUM    The samples each stream ring holds (power of 2, default: %u).\n"
+          "      --writer-cpu CPU   Pin the writer thread to CPU.\n"
+          "      --report T         Print the statistics of every thread each T, in sec\n"
+          "                         unless suffixed, while the test runs.\n"
+          "      --report-to HOST[:PORT]\n"
+          "                         Also send every report (the statistics and histogram\n"
+          "                         of each thread) to a collector over UDP (port %s,\n"
+          "                         reports each %us by default), see docs/fleet_collector.py.\n"
+          "      --start-at TIME    Start the run at the wall clock TIME, in sec since the\n"
+          "                         epoch unless suffixed, so that the runs of synchronized\n"
+          "                         nodes start together.\n"
+          "      --node-name NAME   The name of this node in the reports (default: the\n"
+          "                         host name).\n"
+          "      --hugepages        Back the buffers of the measurement threads by huge\n"
+          "                         pages (hugetlbfs if reserved, THP otherwise).\n"
+          "  -B, --binary           Write the timestamps as a binary sample file.\n"
+          "      --json FILE        Write a JSON summary (config, system, overhead and the\n"
+          "                         statistics and histograms of every thread) to FILE.\n"
+          "      --csv FILE         Write a CSV summary (a row per thread and metric) to FILE.\n"
+          "      --dump FILE        Print a binary sample file as text and exit.\n"
+          "      --task SPEC        Add a thread of a task set, with its own PERIOD (msec\n"
+          "                         unless suffixed), PRIORITY, CPU, busy WORK per cycle\n"
+          "                         (usec unless suffixed) and working SIZE, e.g.\n"
+          "                         5ms:70:1:500us:256K (repeatable).\n"
+          "      --work T           Spin for T each cycle (calibrated), in usec unless\n"
+          "                         suffixed, unless the task gives its own WORK.\n"
+          "      --working-set SIZE Touch SIZE bytes (suffixed with K, M or G) each cycle,\n"
+          "                         unless the task gives its own SIZE.\n"
+          "      --overrun POLICY   After a cycle ends past the next release, run the\n"
+          "                         missed cycles back to back (catchup, default) or skip\n"
+          "                         their releases (skip).\n"
+          "      --interference[=perf]\n"
+          "                         Count the context switches (and the perf cycles, cache\n"
+          "                         and TLB misses) of every cycle by latency band, and the\n"
+          "                         IRQs and SMIs of each CPU.\n"
+          "      --interference-threshold T\n"
+          "                         With --interference, also read the counters of each\n"
+          "                         cycle whose latency exceeds T (in usec unless\n"
+          "                         suffixed, default: the -b threshold), not only on\n"
+          "                         each report.\n"
+          "      --preflight        Report the governor, C-states, isolation, RT throttling\n"
+          "                         and IRQ affinities of the measured CPUs before the run,\n"
+          "                         with a warning for each setting that inflates the latency.\n"
+          "      --tune             Also hold /dev/cpu_dma_latency at 0 and move the IRQs\n"
+          "                         off the measured CPUs for the run (restored at exit).\n"
+          "      --pingpong MECH    Run the threads in pairs on different CPUs, where the\n"
+          "                         first stamps each cycle and wakes the second through\n"
+          "                         MECH (futex, eventfd, sem or spin), which measures\n"
+          "                         the handoff latency (default: 2 threads).\n"
+          "      --load TYPE:LIST   Run a background load on each CPU in LIST, where TYPE is\n"
+          "                         cpu, fp, memcpy, chase or mmap (repeatable).\n"
+          "      --load-size SIZE   The buffer size of the memory loads, suffixed with K, M\n"
+          "                         or G (default: four times the last level cache).\n"
+          "  -h, --help             Print this message.\n",
+          program, program, DEFAULT_PRIORITY, DEFAULT_BUCKET_WIDTH, DEFAULT_CALIBRATION_LOOPS, (u32_t)(DEFAULT_SPIN_MARGIN / NSEC_PER_USEC), DEFAULT_RING_SIZE,
+          DEFAULT_EXPORT_PORT, (u32_t)(DEFAULT_EXPORT_INTERVAL / NSEC_PER_SEC));
+
+  exit(-4);
+}
+
+u8_t parseDuration(const char* arg, u64_t unit, u64_t* nsec)
+{
+  char* end;
+  u64_t value = strtoull(arg, &end, 10);
+
+  if (end == arg)
+    return FALSE;
+
+  if (strcmp(end, "ns") == 0)
+    unit = 1u;
+  else if (strcmp(end, "us") == 0)
+    unit = NSEC_PER_USEC;
+  else if (strcmp(end, "ms") == 0)
+    unit = NSEC_PER_MSEC;
+  else if (strcmp(end, "s") == 0)
+    unit = NSEC_PER_SEC;
+  else if (*end != '\0')
+    return FALSE;
+
+  *nsec = value * unit;
+
+  return TRUE;
+}
+
+u32_t parseCpuList(const char* list, u32_t* cpus, u32_t max)
+{
+  u32_t count = 0u;
+  const char* cur = list;
+  char* end;
+  unsigned long first, last;
+
+  while (*cur != '\0')
+  {
+    first = strtoul(cur, &end, 10);
+    if (end == cur)
+      return 0u;
+
+    last = first;
+    if (*end == '-')
+    {
+      cur = end + 1;
+      last = strtoul(cur, &end, 10);
+      if ((end == cur) || (last < first))
+        return 0u;
+    }
+
+    for (; first <= last; first++)
+    {
+      if (count >= max)
+        return 0u;
+
+      cpus[count++] = (u32_t)first;
+    }
+
+    if (*end == ',')
+      end++;
+    else if (*end != '\0')
+      return 0u;
+
+    cur = end;
+  }
+  return count;
+}
+
+u8_t parseSize(const char* arg, u64_t* bytes)
+{
+  char* end;
+  u64_t value = strtoull(arg, &end, 10);
+
+  if (end == arg)
+    return FALSE;
+
+  if (strcmp(end, "K") == 0)
+    value <<= 10;
+  else if (strcmp(end, "M") == 0)
+    value <<= 20;
+  else if (strcmp(end, "G") == 0)
+    value <<= 30;
+  else if (*end != '\0')
+    return FALSE;
+
+  *bytes = value;
+
+  return TRUE;
+}
+
+u8_t parseLoad(const char* arg, sched_config_t* config)
+{
+  u32_t cpus[MAX_LOAD_THREADS];
+  char name[16];
+  const char* list = strchr(arg, ':');
+  load_type_t type;
+  u32_t count, i;
+
+  if ((list == NULL) || ((size_t)(list - arg) >= sizeof(name)))
+    return FALSE;
+
+  memcpy(name, arg, (size_t)(list - arg));
+  name[list - arg] = '\0';
+
+  if (!getLoadType(name, &type))
+    return FALSE;
+
+  count = parseCpuList(list + 1, cpus, MAX_LOAD_THREADS);
+  if ((count == 0u) || ((config->num_loads + count) > MAX_LOAD_THREADS))
+    return FALSE;
+
+  for (i = 0u; i < count; i++)
+  {
+    config->loads[config->num_loads].type = type;
+    config->loads[config->num_loads].cpu = cpus[i];
+    config->num_loads++;
+  }
+
+  return TRUE;
+}
+
+u8_t parseTask(const char* arg, sched_config_t* config)
+{
+  char spec[128];
+  char* fields[5] = { NULL, NULL, NULL, NULL, NULL };
+  char* save = NULL;
+  char* end;
+  u32_t count = 0u;
+  const u32_t i = config->num_tasks;
+
+  if ((i >= MAX_THREADS) || (strlen(arg) >= sizeof(spec)))
+    return FALSE;
+
+  strcpy(spec, arg);
+
+  for (fields[0] = strtok_r(spec, ":", &save); (fields[count] != NULL) && (count < 5u); )
+    if (++count < 5u)
+      fields[count] = strtok_r(NULL, ":", &save);
+
+  if ((count < 3u) || (strtok_r(NULL, ":", &save) != NULL))
+    return FALSE;
+
+  /* The period is in msec and the work in usec unless suffixed, as the cycle time. */
+  if (!parseDuration(fields[0], NSEC_PER_MSEC, &config->cycle_times[i]) || (config->cycle_times[i] == 0u))
+    return FALSE;
+
+  config->priorities[i] = (u32_t)strtoul(fields[1], &end, 10);
+  if ((end == fields[1]) || (*end != '\0'))
+    return FALSE;
+
+  config->cpus[i] = (u32_t)strtoul(fields[2], &end, 10);
+  if ((end == fields[2]) || (*end != '\0'))
+    return FALSE;
+
+  config->work[i] = UNSET_WORK;
+  if ((count >= 4u) && !parseDuration(fields[3], NSEC_PER_USEC, &config->work[i]))
+    return FALSE;
+
+  config->working_sets[i] = UNSET_WORK;
+  if ((count == 5u) && !parseSize(fields[4], &config->working_sets[i]))
+    return FALSE;
+
+  config->num_tasks++;
+
+  return TRUE;
+}
+
+/***************************** Public Functions ******************************/
+
+void parseConfig(int argc, char** argv, sched_config_t* config)
+{
+  static const struct option long_options[] =
+  {
+    { "threads",      required_argument, NULL, 't'              },
+    { "affinity",     required_argument, NULL, 'a'              },
+    { "policy",       required_argument, NULL, OPT_POLICY       },
+    { "priority",     required_argument, NULL, 'p'              },
+    { "dl-runtime",   required_argument, NULL, OPT_DL_RUNTIME   },
+    { "dl-deadline",  required_argument, NULL, OPT_DL_DEADLINE  },
+    { "duration",     required_argument, NULL, 'D'              },
+    { "bucket-width", required_argument, NULL, OPT_BUCKET_WIDTH },
+    { "clock",        required_argument, NULL, OPT_CLOCK        },
+    { "calibrate",    optional_argument, NULL, OPT_CALIBRATE    },
+    { "subtract-overhead", no_argument,  NULL, OPT_SUBTRACT     },
+    { "wait",         required_argument, NULL, OPT_WAIT         },
+    { "spin-margin",  required_argument, NULL, OPT_SPIN_MARGIN  },
+    { "phase",        required_argument, NULL, OPT_PHASE        },
+    { "wakeup",       no_argument,       NULL, 'W'              },
+    { "breaktrace",   required_argument, NULL, 'b'              },
+    { "stats-only",   no_argument,       NULL, 's'              },
+    { "stream",       no_argument,       NULL, 'r'              },
+    { "ring-size",    required_argument, NULL, OPT_RING_SIZE    },
+    { "writer-cpu",   required_argument, NULL, OPT_WRITER_CPU   },
+    { "hugepages",    no_argument,       NULL, OPT_HUGE_PAGES   },
+    { "binary",       no_argument,       NULL, 'B'              },
+    { "report",       required_argument, NULL, OPT_REPORT       },
+    { "report-to",    required_argument, NULL, OPT_REPORT_TO    },
+    { "start-at",     required_argument, NULL, OPT_START_AT     },
+    { "node-name",    required_argument, NULL, OPT_NODE_NAME    },
+    { "json",         required_argument, NULL, OPT_JSON         },
+    { "csv",          required_argument, NULL, OPT_CSV          },
+    { "dump",         required_argument, NULL, OPT_DUMP         },
+    { "task",         required_argument, NULL, OPT_TASK         },
+    { "work",         required_argument, NULL, OPT_WORK         },
+    { "working-set",  required_argument, NULL, OPT_WORKING_SET  },
+    { "overrun",      required_argument, NULL, OPT_OVERRUN      },
+    { "interference", optional_argument, NULL, OPT_INTERFERENCE },
+    { "interference-threshold", required_argument, NULL, OPT_INTERFERENCE_THRESHOLD },
+    { "preflight",    no_argument,       NULL, OPT_PREFLIGHT    },
+    { "tune",         no_argument,       NULL, OPT_TUNE         },
+    { "pingpong",     required_argument, NULL, OPT_PINGPONG     },
+    { "load",         required_argument, NULL, OPT_LOAD         },
+    { "load-size",    required_argument, NULL, OPT_LOAD_SIZE    },
+    { "help",         no_argument,       NULL, 'h'              },
+    { NULL,           0,                 NULL, 0                }
+  };
+
+  u32_t num_affinities = 0u;
+  u32_t num_priorities = 0u;
+  u32_t num_args;
+  u8_t threads_given = FALSE;
+  long num_cpus;
+  u32_t i;
+  int opt;
+
+  memset(config, 0, sizeof(*config));
+  config->num_threads = 1u;
+  config->bucket_width = DEFAULT_BUCKET_WIDTH;
+  config->sample_mode = DEFAULT_SAMPLE_MODE;
+  config->clock_source = DEFAULT_CLOCK_SOURCE;
+  config->policy = SCHED_POLICY_RR;
+  config->wait_mode = WAIT_MODE_SLEEP;
+  config->spin_margin = DEFAULT_SPIN_MARGIN;
+  config->phase_mode = PHASE_MODE_ALIGN;
+  config->ring_size = DEFAULT_RING_SIZE;
+  config->writer_cpu = -1;
+  config->output_format = OUTPUT_FORMAT_TEXT;
+  config->overrun_policy = OVERRUN_POLICY_CATCHUP;
+
+  while ((opt = getopt_long(argc, argv, "t:a:p:D:Wb:srBh", long_options, NULL)) != -1)
+  {
+    switch (opt)
+    {
+      case 't':
+        config->num_threads = strtoul(optarg, NULL, 0);
+        if ((config->num_threads == 0u) || (config->num_threads > MAX_THREADS))
+        {
+          fprintf(stderr, "Invalid number of threads (1-%u)\n", MAX_THREADS);
+          exit(-4);
+        }
+        threads_given = TRUE;
+        break;
+
+      case 'a':
+        num_affinities = parseCpuList(optarg, config->cpus, MAX_THREADS);
+        if (num_affinities == 0u)
+        {
+          fprintf(stderr, "Invalid CPU list: %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      case OPT_POLICY:
+        if (!getSchedPolicy(optarg, &config->policy))
+        {
+          fprintf(stderr, "Invalid scheduling policy: %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      case 'p':
+        num_priorities = parseCpuList(optarg, config->priorities, MAX_THREADS);
+        if (num_priorities == 0u)
+        {
+          fprintf(stderr, "Invalid priority list: %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      case OPT_DL_RUNTIME:
+        if (!parseDuration(optarg, 1u, &config->dl_runtime) || (config->dl_runtime == 0u))
+        {
+          fprintf(stderr, "Invalid deadline runtime: %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      case OPT_DL_DEADLINE:
+        if (!parseDuration(optarg, 1u, &config->dl_deadline) || (config->dl_deadline == 0u))
+        {
+          fprintf(stderr, "Invalid deadline: %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      case 'D':
+        if (!parseDuration(optarg, NSEC_PER_SEC, &config->duration) || (config->duration == 0u))
+        {
+          fprintf(stderr, "Invalid duration: %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      case OPT_BUCKET_WIDTH:
+        if (!parseDuration(optarg, 1u, &config->bucket_width) || (config->bucket_width == 0u))
+        {
+          fprintf(stderr, "Invalid bucket width: %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      case OPT_CLOCK:
+        if (strcmp(optarg, "monotonic") == 0)
+          config->clock_source = CLOCK_SOURCE_MONOTONIC;
+        else if ((strcmp(optarg, "counter") == 0) || (strcmp(optarg, "tsc") == 0) ||
+                 (strcmp(optarg, "cntvct") == 0))
+          config->clock_source = CLOCK_SOURCE_COUNTER;
+        else
+        {
+          fprintf(stderr, "Invalid clock: %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      case OPT_CALIBRATE:
+        config->calibration_loops = (optarg != NULL) ? strtoul(optarg, NULL, 0) : DEFAULT_CALIBRATION_LOOPS;
+        if (config->calibration_loops == 0u)
+        {
+          fprintf(stderr, "Invalid number of calibration loops: %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      case OPT_SUBTRACT:
+        config->subtract_overhead = TRUE;
+        break;
+
+      case OPT_WAIT:
+        if (strcmp(optarg, "sleep") == 0)
+          config->wait_mode = WAIT_MODE_SLEEP;
+        else if (strcmp(optarg, "spin") == 0)
+          config->wait_mode = WAIT_MODE_SPIN;
+        else if (strcmp(optarg, "hybrid") == 0)
+          config->wait_mode = WAIT_MODE_HYBRID;
+        else
+        {
+          fprintf(stderr, "Invalid wait mode: %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      case OPT_SPIN_MARGIN:
+        if (!parseDuration(optarg, 1u, &config->spin_margin))
+        {
+          fprintf(stderr, "Invalid spin margin: %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      case OPT_PHASE:
+        if (strcmp(optarg, "align") == 0)
+          config->phase_mode = PHASE_MODE_ALIGN;
+        else if (strcmp(optarg, "stagger") == 0)
+          config->phase_mode = PHASE_MODE_STAGGER;
+        else
+        {
+          fprintf(stderr, "Invalid phase mode: %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      case 'W':
+        config->track_wakeup = TRUE;
+        break;
+
+      case 'b':
+        if (!parseDuration(optarg, NSEC_PER_USEC, &config->break_threshold) || (config->break_threshold == 0u))
+        {
+          fprintf(stderr, "Invalid breaktrace threshold: %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      case 's':
+        config->sample_mode = SAMPLE_MODE_NONE;
+        break;
+
+      case 'r':
+        config->sample_mode = SAMPLE_MODE_STREAM;
+        break;
+
+      case OPT_RING_SIZE:
+        config->ring_size = strtoul(optarg, NULL, 0);
+        if ((config->ring_size == 0u) || ((config->ring_size & (config->ring_size - 1u)) != 0u))
+        {
+          fprintf(stderr, "Invalid ring size (must be a power of 2): %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      case OPT_WRITER_CPU:
+        config->writer_cpu = (s32_t)strtol(optarg, NULL, 0);
+        break;
+
+      case OPT_HUGE_PAGES:
+        config->huge_pages = TRUE;
+        break;
+
+      case 'B':
+        config->output_format = OUTPUT_FORMAT_BINARY;
+        break;
+
+      case OPT_REPORT:
+        if (!parseDuration(optarg, NSEC_PER_SEC, &config->report_interval) || (config->report_interval == 0u))
+        {
+          fprintf(stderr, "Invalid report interval: %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      case OPT_REPORT_TO:
+        config->report_target = optarg;
+        break;
+
+      case OPT_NODE_NAME:
+        config->node_name = optarg;
+        break;
+
+      case OPT_START_AT:
+        if (!parseDuration(optarg, NSEC_PER_SEC, &config->start_at) || (config->start_at == 0u))
+        {
+          fprintf(stderr, "Invalid start time: %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      case OPT_JSON:
+        config->json_file = optarg;
+        break;
+
+      case OPT_CSV:
+        config->csv_file = optarg;
+        break;
+
+      case OPT_DUMP:
+        config->dump_file = optarg;
+        return;
+
+      case OPT_TASK:
+        if (!parseTask(optarg, config))
+        {
+          fprintf(stderr, "Invalid task (at most %u tasks): %s\n", MAX_THREADS, optarg);
+          exit(-4);
+        }
+        break;
+
+      case OPT_WORK:
+        if (!parseDuration(optarg, NSEC_PER_USEC, &config->default_work))
+        {
+          fprintf(stderr, "Invalid work: %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      case OPT_WORKING_SET:
+        if (!parseSize(optarg, &config->default_working_set))
+        {
+          fprintf(stderr, "Invalid working set: %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      case OPT_OVERRUN:
+        if (strcmp(optarg, "catchup") == 0)
+          config->overrun_policy = OVERRUN_POLICY_CATCHUP;
+        else if (strcmp(optarg, "skip") == 0)
+          config->overrun_policy = OVERRUN_POLICY_SKIP;
+        else
+        {
+          fprintf(stderr, "Invalid overrun policy: %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      case OPT_INTERFERENCE:
+        config->interference = TRUE;
+        if (optarg != NULL)
+        {
+          if (strcmp(optarg, "perf") != 0)
+          {
+            fprintf(stderr, "Invalid interference counters: %s\n", optarg);
+            exit(-4);
+          }
+          config->perf_counters = TRUE;
+        }
+        break;
+
+      case OPT_INTERFERENCE_THRESHOLD:
+        if (!parseDuration(optarg, NSEC_PER_USEC, &config->interference_threshold) ||
+            (config->interference_threshold == 0u))
+        {
+          fprintf(stderr, "Invalid interference threshold: %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      case OPT_PREFLIGHT:
+        config->preflight = TRUE;
+        break;
+
+      case OPT_TUNE:
+        config->preflight = config->tune = TRUE;
+        break;
+
+      case OPT_PINGPONG:
+        config->pingpong = TRUE;
+        if (!getPingPongMode(optarg, &config->pingpong_mode))
+        {
+          fprintf(stderr, "Invalid pingpong mechanism: %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      case OPT_LOAD:
+        if (!parseLoad(optarg, config))
+        {
+          fprintf(stderr, "Invalid load (at most %u threads): %s\n", MAX_LOAD_THREADS, optarg);
+          exit(-4);
+        }
+        break;
+
+      case OPT_LOAD_SIZE:
+        if (!parseSize(optarg, &config->load_size) || (config->load_size < sizeof(u64_t)))
+        {
+          fprintf(stderr, "Invalid load size: %s\n", optarg);
+          exit(-4);
+        }
+        break;
+
+      default:
+        printUsage(argv[0]);
+    }
+  }
+
+  /* A task set gives the periods itself, and a timed run needs no number of cycles. */
+  num_args = (u32_t)(argc - optind);
+  if ((config->num_tasks > 0u) ? (num_args > 1u) :
+      ((num_args != 2u) && ((num_args != 1u) || (config->duration == 0u))))
+  {
+    fprintf(stderr, "Wrong number of arguments\n");
+    printUsage(argv[0]);
+  }
+
+  if (config->num_tasks > 0u)
+  {
+    if (threads_given || (num_affinities > 0u) || (num_priorities > 0u))
+    {
+      fprintf(stderr, "A task set can not be combined with -t, -a or -p\n");
+      exit(-4);
+    }
+
+    config->cycle_num = (num_args == 1u) ? strtoull(argv[optind], NULL, 0) : 0u;
+    config->num_threads = num_affinities = num_priorities = config->num_tasks;
+
+    for (i = 0u, config->cycle_time = U64_MAX; i < config->num_tasks; i++)
+      if (config->cycle_times[i] < config->cycle_time)
+        config->cycle_time = config->cycle_times[i];
+  }
+  else
+  {
+    config->cycle_num = (num_args == 2u) ? strtoull(argv[optind + 1], NULL, 0) : 0u;
+
+    if (!parseDuration(argv[optind], NSEC_PER_MSEC, &config->cycle_time) || (config->cycle_time == 0u))
+    {
+      fprintf(stderr, "Invalid cycle time: %s\n", argv[optind]);
+      exit(-4);
+    }
+  }
+
+  /* The collector merges the reports, so a run that sends them reports periodically. */
+  if ((config->report_target != NULL) && (config->report_interval == 0u))
+    config->report_interval = DEFAULT_EXPORT_INTERVAL;
+
+  /* The outliers the trace breaks on are the ones whose interference is wanted. */
+  if (config->interference_threshold == 0u)
+    config->interference_threshold = config->break_threshold;
+
+  /* The overhead can only be subtracted once it is measured. */
+  if (config->subtract_overhead && (config->calibration_loops == 0u))
+    config->calibration_loops = DEFAULT_CALIBRATION_LOOPS;
+
+#ifdef STATS_ONLY
+  if (config->sample_mode != SAMPLE_MODE_NONE)
+  {
+    fprintf(stderr, "This build keeps only the statistics (no --stream)\n");
+    exit(-4);
+  }
+#endif
+
+  if ((config->cycle_num == 0u) && (config->duration == 0u) && (config->sample_mode == SAMPLE_MODE_BUFFER))
+  {
+    fprintf(stderr, "An unbounded run needs --stats-only or --stream\n");
+    exit(-4);
+  }
+
+  /* Without an explicit thread count, spawn one thread per listed CPU. */
+  if ((num_affinities > 0u) && !threads_given)
+    config->num_threads = num_affinities;
+
+  /* The second thread of each pair is woken by the first, so it has no period of its own. */
+  if (config->pingpong)
+  {
+    if ((config->num_tasks > 0u) || (config->policy == SCHED_POLICY_DEADLINE))
+    {
+      fprintf(stderr, "--pingpong can not be combined with a task set or deadline threads\n");
+      exit(-4);
+    }
+
+    if ((num_affinities <= 1u) && !threads_given)
+      config->num_threads = 2u;
+
+    if ((config->num_threads % 2u) != 0u)
+    {
+      fprintf(stderr, "--pingpong needs an even number of threads\n");
+      exit(-4);
+    }
+  }
+
+  /* Distribute the remaining threads over the online CPUs (or the given list). */
+  num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (num_cpus <= 0)
+    num_cpus = 1;
+
+  for (i = num_affinities; i < config->num_threads; i++)
+  {
+    if (num_affinities > 0u)
+      config->cpus[i] = config->cpus[i % num_affinities];
+    else
+      config->cpus[i] = i % (u32_t)num_cpus;
+  }
+
+  for (i = 0u; config->pingpong && (i < config->num_threads); i += 2u)
+  {
+    /* A spinning wakee would never let the waker run on a shared CPU. */
+    if ((config->cpus[i] == config->cpus[i + 1u]) && (config->pingpong_mode == PINGPONG_MODE_SPIN))
+    {
+      fprintf(stderr, "The threads of a spin pair must be on different CPUs (T:%u and T:%u)\n", i, i + 1u);
+      exit(-4);
+    }
+
+    if (config->cpus[i] == config->cpus[i + 1u])
+      fprintf(stderr, "Warning: T:%u and T:%u share CPU %u, the handoff is not cross-core\n",
+              i, i + 1u, config->cpus[i]);
+  }
+
+  for (i = config->num_tasks; i < config->num_threads; i++)
+  {
+    config->cycle_times[i] = config->cycle_time;
+    config->work[i] = config->working_sets[i] = UNSET_WORK;
+  }
+
+  /* The tasks that give no work (and every thread without a task set) do the default one. */
+  for (i = 0u; i < config->num_threads; i++)
+  {
+    if (config->work[i] == UNSET_WORK)
+      config->work[i] = config->default_work;
+
+    if (config->working_sets[i] == UNSET_WORK)
+      config->working_sets[i] = config->default_working_set;
+  }
+
+  for (i = 0u; i < config->num_threads; i++)
+  {
+    /* A timed run buffers the cycles that fit in its duration. */
+    config->cycle_nums[i] = config->cycle_num;
+    if ((config->duration > 0u) && (config->cycle_num == 0u) && (config->sample_mode == SAMPLE_MODE_BUFFER))
+      config->cycle_nums[i] = (config->duration / config->cycle_times[i]) + 1u;
+
+    /* A deadline period is a cycle, with a runtime and deadline within it. */
+    if ((config->policy == SCHED_POLICY_DEADLINE) &&
+        ((getDeadlineRuntime(config, i) > getDeadlineDeadline(config, i)) ||
+         (getDeadlineDeadline(config, i) > config->cycle_times[i])))
+    {
+      fprintf(stderr, "The deadline runtime, deadline and cycle time must be in ascending order\n");
+      exit(-4);
+    }
+  }
+
+  /* The remaining threads repeat the given priorities. */
+  for (i = num_priorities; i < config->num_threads; i++)
+    config->priorities[i] = (num_priorities > 0u) ? config->priorities[i % num_priorities] : DEFAULT_PRIORITY;
+
+  for (i = 0u; (config->policy != SCHED_POLICY_DEADLINE) && (i < config->num_threads); i++)
+  {
+    if ((config->priorities[i] < (u32_t)sched_get_priority_min(getSchedPolicyId(config->policy))) ||
+        (config->priorities[i] > (u32_t)sched_get_priority_max(getSchedPolicyId(config->policy))))
+    {
+      fprintf(stderr, "Invalid priority for %s: %u\n", getSchedPolicyName(config->policy), config->priorities[i]);
+      exit(-4);
+    }
+  }
+}
+
+u64_t getDeadlineRuntime(const sched_config_t* config, u32_t thread)
+{
+  return (config->dl_runtime > 0u) ? config->dl_runtime : (config->cycle_times[thread] / DEFAULT_DL_RUNTIME_DIVIDER);
+}
+
+u64_t getDeadlineDeadline(const sched_config_t* config, u32_t thread)
+{
+  return (config->dl_deadline > 0u) ? config->dl_deadline : config->cycle_times[thread];
+}
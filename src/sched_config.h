@@ -0,0 +1,183 @@
+/**
+  * @file sched_config.h
+  * @brief Contains the run configuration and the declarations of functions
+  *        defined in sched_config.c.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+#ifndef SCHED_CONFIG_H
+#define SCHED_CONFIG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************** Inclusions *********************************/
+
+#include "data_types.h"
+#include "sched_statistics.h"
+#include "sched_clock.h"
+#include "sched_load.h"
+#include "sched_policy.h"
+#include "sched_pingpong.h"
+
+/***************************** Macro Definitions *****************************/
+
+/** The maximum number of measurement threads that can be spawned. */
+#define MAX_THREADS (64u)
+
+/***************************** Type Definitions ******************************/
+
+/** The ways the samples of a measurement thread are kept. */
+typedef enum
+{
+  SAMPLE_MODE_BUFFER,  /**< Keep every timestamp in memory until the end of the run. */
+  SAMPLE_MODE_NONE,    /**< Keep only the running statistics and the histogram. */
+  SAMPLE_MODE_STREAM   /**< Stream every timestamp to a writer thread through a ring. */
+} sample_mode_t;
+
+/** The formats the timestamps are written in. */
+typedef enum
+{
+  OUTPUT_FORMAT_TEXT,   /**< One "SEC.NSEC" line (nine digits of nsec) per sample, after the statistics. */
+  OUTPUT_FORMAT_BINARY  /**< A sample file header followed by s64_t nsec records. */
+} output_format_t;
+
+/** The ways a task waits for its next shot. */
+typedef enum
+{
+  WAIT_MODE_SLEEP,   /**< Sleep with clock_nanosleep until the deadline. */
+  WAIT_MODE_SPIN,    /**< Spin on the clock until the deadline. */
+  WAIT_MODE_HYBRID   /**< Sleep until the deadline minus a margin, then spin. */
+} wait_mode_t;
+
+/** How the cycles of the measurement threads are placed relative to each other. */
+typedef enum
+{
+  PHASE_MODE_ALIGN,   /**< Every thread wakes up at the same deadlines. */
+  PHASE_MODE_STAGGER  /**< The threads are spread evenly over a cycle. */
+} phase_mode_t;
+
+/** What a thread does after an overrun, i.e. a cycle that ended after the next release. */
+typedef enum
+{
+  OVERRUN_POLICY_CATCHUP,  /**< Run the missed cycles back to back, keeping the timer. */
+  OVERRUN_POLICY_SKIP      /**< Skip the missed releases, and wait for the next one. */
+} overrun_policy_t;
+
+/** A build may keep only the statistics (see the Makefile), so that the
+  * sampling loop stores no timestamp.
+  */
+#ifdef STATS_ONLY
+#define DEFAULT_SAMPLE_MODE (SAMPLE_MODE_NONE)
+#else
+#define DEFAULT_SAMPLE_MODE (SAMPLE_MODE_BUFFER)
+#endif
+
+/** The priority that will be given to the created tasks (threads) from the OS.
+  * Since the PRREMPT_RT uses 50 as the priority of kernel tasklets and
+  * interrupt handlers by default, the maximum available priority is chosen.
+  * The priority of each task should be the same, since the Round-Robin
+  * scheduling policy is used by default and each task is executed with
+  * the same time slice.
+  */
+#ifndef DEFAULT_PRIORITY
+#define DEFAULT_PRIORITY (49u)
+#endif
+
+/** The default runtime of a SCHED_DEADLINE period, as a fraction of the cycle time. */
+#define DEFAULT_DL_RUNTIME_DIVIDER (10u)
+
+/** The default margin of the hybrid wait mode in nsec. */
+#define DEFAULT_SPIN_MARGIN (20u * NSEC_PER_USEC)
+
+/** The configuration of a test run, as given by the command line. */
+typedef struct
+{
+  u64_t cycle_time;          /**< The cycle time between the task calls in nsec (the shortest of a task set). */
+  u64_t cycle_num;           /**< The number of cycles each task will run for (0 for unbounded). */
+  u64_t cycle_times[MAX_THREADS]; /**< The cycle time of each measurement thread in nsec. */
+  u64_t cycle_nums[MAX_THREADS]; /**< The number of cycles of each measurement thread (0 for unbounded). */
+  u64_t work[MAX_THREADS];   /**< The busy work (calibrated spin) of each cycle of each thread in nsec. */
+  u64_t working_sets[MAX_THREADS]; /**< The memory each thread touches every cycle in bytes. */
+  u64_t default_work;        /**< The busy work of the threads that give none in nsec. */
+  u64_t default_working_set; /**< The working set of the threads that give none in bytes. */
+  overrun_policy_t overrun_policy; /**< What the threads do after an overrun. */
+  u8_t interference;         /**< Whether the interference of every cycle is counted. */
+  u8_t perf_counters;        /**< Whether the perf_event counters are read as well. */
+  u64_t interference_threshold; /**< The latency of a cycle whose counters are read at once in nsec (0 for none). */
+  u8_t preflight;            /**< Whether the system settings are checked before the run. */
+  u8_t tune;                 /**< Whether the system is tuned for the run (and restored after it). */
+  u8_t pingpong;             /**< Whether the threads run in pairs, the first waking the second. */
+  pingpong_mode_t pingpong_mode; /**< How the first thread of each pair wakes the second. */
+  u32_t num_tasks;           /**< The number of threads given as a task set (0 without one). */
+  u64_t duration;            /**< The time the run is stopped after in nsec (0 for no limit). */
+  u32_t num_threads;         /**< The number of measurement threads. */
+  u32_t cpus[MAX_THREADS];   /**< The CPU affinity of each measurement thread. */
+  sched_policy_t policy;     /**< The scheduling policy of the measurement threads. */
+  u32_t priorities[MAX_THREADS]; /**< The priority of each measurement thread (not with SCHED_DEADLINE). */
+  u64_t dl_runtime;          /**< The runtime of each SCHED_DEADLINE period in nsec (0 for the default). */
+  u64_t dl_deadline;         /**< The relative deadline of each SCHED_DEADLINE period in nsec (0 for the period). */
+  u64_t bucket_width;        /**< The width of a histogram bucket in nsec. */
+  u8_t track_wakeup;         /**< Also measure the wakeup latency against the deadline. */
+  clock_source_t clock_source; /**< The clock the timestamps are taken from. */
+  u32_t calibration_loops;   /**< The loops of the overhead calibration (0 to skip it). */
+  u8_t subtract_overhead;    /**< Subtract the median overhead from the wakeup latency. */
+  wait_mode_t wait_mode;     /**< How the tasks wait for their next shot. */
+  u64_t spin_margin;         /**< The time spun before the deadline in hybrid mode in nsec. */
+  phase_mode_t phase_mode;   /**< How the deadlines of the threads are placed. */
+  u64_t break_threshold;     /**< The latency that stops ftrace in nsec (0 to never stop it). */
+  sample_mode_t sample_mode; /**< How the samples are kept. */
+  u64_t ring_size;           /**< The number of samples of each ring in stream mode. */
+  s32_t writer_cpu;          /**< The CPU of the writer thread (-1 for the process affinity). */
+  u8_t huge_pages;           /**< Back the sample arena by huge pages if possible. */
+  output_format_t output_format; /**< The format of the timestamps files. */
+  u64_t report_interval;     /**< The period of the live statistics in nsec (0 for none). */
+  const char* json_file;     /**< The file of the JSON summary (NULL for none). */
+  const char* csv_file;      /**< The file of the CSV summary (NULL for none). */
+  const char* report_target; /**< The collector the reports are sent to as HOST[:PORT] (NULL for none). */
+  const char* node_name;     /**< The name the collector knows this node by (NULL for the host name). */
+  u64_t start_at;            /**< The wall clock time the run starts at in nsec since the epoch (0 for now). */
+  const char* dump_file;     /**< A sample file to print as text instead of running. */
+  load_spec_t loads[MAX_LOAD_THREADS]; /**< The background load threads. */
+  u32_t num_loads;           /**< The number of background load threads. */
+  u64_t load_size;           /**< The buffer size of the memory loads in bytes (0 for auto). */
+} sched_config_t;
+
+/***************************** Public Functions ******************************/
+
+/**
+  * @brief Parse the command line into a run configuration.
+  * @details Exits the program if the arguments are invalid.
+  * @param argc The number of arguments.
+  * @param argv The argument vector.
+  * @param config The configuration to fill.
+  * @return Void.
+  */
+void parseConfig(int argc, char** argv, sched_config_t* config);
+
+/**
+  * @brief Get the SCHED_DEADLINE runtime of a measurement thread.
+  * @param config The configuration of the run.
+  * @param thread The index of the thread.
+  * @return The runtime of each period in nsec.
+  */
+u64_t getDeadlineRuntime(const sched_config_t* config, u32_t thread);
+
+/**
+  * @brief Get the SCHED_DEADLINE relative deadline of a measurement thread.
+  * @param config The configuration of the run.
+  * @param thread The index of the thread.
+  * @return The relative deadline of each period in nsec.
+  */
+u64_t getDeadlineDeadline(const sched_config_t* config, u32_t thread);
+
+/*****************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* SCHED_CONFIG_H */
@@ -0,0 +1,172 @@
+/**
+  * @file sched_export.c
+  * @brief Implements the export of the periodic statistics snapshots to a
+  *        collector over UDP, so that the runs of many nodes are merged
+  *        (see docs/fleet_collector.py).
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+#define _GNU_SOURCE
+
+/******************************** Inclusions *********************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/utsname.h>
+
+#include "sched_export.h"
+
+/***************************** Macro Definitions *****************************/
+
+/** The largest UDP payload (over IPv4), which a metric with every bucket filled fits in. */
+#define EXPORT_DATAGRAM_SIZE (65507u)
+
+/** The longest HOST:PORT of a collector. */
+#define EXPORT_TARGET_SIZE (256u)
+
+/***************************** Static Variables ******************************/
+
+/** The socket connected to the collector (-1 if not exporting). */
+static int export_socket = -1;
+
+/** The name of this node, as the collector tells the nodes apart by. */
+static char node_name[sizeof(((struct utsname*)NULL)->nodename)];
+
+/** The datagram that is being written (too large for the stack of the reporter). */
+static char datagram[EXPORT_DATAGRAM_SIZE];
+
+/************************ Static Function Prototypes *************************/
+
+/**
+  * @brief Send a metric of a thread as a datagram.
+  * @param thread The results of the thread.
+  * @param num_threads The number of measurement threads of the run.
+  * @param metric The name of the metric.
+  * @param latency The latency metric to send.
+  * @param sequence The number of the report.
+  * @param done Whether these are the final results of the thread.
+  * @return Void.
+  */
+static void sendMetric(const summary_thread_t* thread, u32_t num_threads, const char* metric,
+                       const latency_statistics_t* latency, u64_t sequence, u8_t done);
+
+/***************************** Static Functions ******************************/
+
+void sendMetric(const summary_thread_t* thread, u32_t num_threads, const char* metric,
+                const latency_statistics_t* latency, u64_t sequence, u8_t done)
+{
+  FILE* file;
+  long size;
+
+  if ((file = fmemopen(datagram, sizeof(datagram), "w")) == NULL)
+    return;
+
+  writeSnapshotJson(file, node_name, thread, num_threads, metric, latency, sequence, done);
+
+  /* A truncated snapshot would not parse, so it is not sent. */
+  fflush(file);
+  size = ftell(file);
+  if (ferror(file) || (size <= 0) || ((u64_t)size >= sizeof(datagram)))
+  {
+    fclose(file);
+    return;
+  }
+
+  fclose(file);
+
+  /* A lost datagram is made up for by the next snapshot. */
+  (void)send(export_socket, datagram, (size_t)size, 0);
+}
+
+/***************************** Public Functions ******************************/
+
+u8_t initExport(const char* target, const char* node)
+{
+  struct addrinfo hints, *addresses, *address;
+  struct utsname name;
+  char host[EXPORT_TARGET_SIZE];
+  const char* port;
+  char* separator;
+
+  if (strlen(target) >= sizeof(host))
+    return FALSE;
+
+  /* An IPv6 address is bracketed when it is followed by a port, e.g. [::1]:9870. */
+  strcpy(host, target);
+  port = DEFAULT_EXPORT_PORT;
+  if ((host[0] == '[') && ((separator = strchr(host, ']')) != NULL))
+  {
+    *separator = '\0';
+    memmove(host, host + 1, strlen(host));
+    if (separator[1] == ':')
+      port = separator + 2;
+  }
+  else if (((separator = strchr(host, ':')) != NULL) && (strchr(separator + 1, ':') == NULL))
+  {
+    *separator = '\0';
+    port = separator + 1;
+  }
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_DGRAM;
+
+  if (getaddrinfo(host, port, &hints, &addresses) != 0)
+    return FALSE;
+
+  for (address = addresses; address != NULL; address = address->ai_next)
+  {
+    if ((export_socket = socket(address->ai_family, address->ai_socktype, address->ai_protocol)) < 0)
+      continue;
+
+    if (connect(export_socket, address->ai_addr, address->ai_addrlen) == 0)
+      break;
+
+    close(export_socket);
+    export_socket = -1;
+  }
+
+  freeaddrinfo(addresses);
+
+  if (export_socket < 0)
+    return FALSE;
+
+  /* Boards cloned from one image often share their host name. */
+  if (node != NULL)
+    snprintf(node_name, sizeof(node_name), "%s", node);
+  else if (uname(&name) == 0)
+    strcpy(node_name, name.nodename);
+
+  return TRUE;
+}
+
+void exportSnapshot(const summary_thread_t* thread, u32_t num_threads, u64_t sequence, u8_t done)
+{
+  if (export_socket < 0)
+    return;
+
+  sendMetric(thread, num_threads, "jitter", &thread->stats->jitter, sequence, done);
+
+  if (thread->stats->track_wakeup)
+    sendMetric(thread, num_threads, "wakeup", &thread->stats->wakeup, sequence, done);
+
+  if (thread->stats->track_handoff)
+    sendMetric(thread, num_threads, "handoff", &thread->stats->handoff, sequence, done);
+
+  if (thread->stats->track_response)
+    sendMetric(thread, num_threads, "response", &thread->stats->response, sequence, done);
+}
+
+void closeExport(void)
+{
+  if (export_socket >= 0)
+    close(export_socket);
+
+  export_socket = -1;
+}
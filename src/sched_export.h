@@ -0,0 +1,64 @@
+/**
+  * @file sched_export.h
+  * @brief Contains the declarations of functions defined in sched_export.c.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+#ifndef SCHED_EXPORT_H
+#define SCHED_EXPORT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************** Inclusions *********************************/
+
+#include "data_types.h"
+#include "sched_summary.h"
+
+/***************************** Macro Definitions *****************************/
+
+/** The default port of the collector. */
+#define DEFAULT_EXPORT_PORT "9870"
+
+/** The report interval of a run that exports its snapshots, unless given (in nsec). */
+#define DEFAULT_EXPORT_INTERVAL (NSEC_PER_SEC)
+
+/***************************** Public Functions ******************************/
+
+/**
+  * @brief Open the UDP socket the snapshots are sent to the collector through.
+  * @param target The collector as HOST[:PORT] (the port defaults to DEFAULT_EXPORT_PORT).
+  * @param node The name of this node in the snapshots (NULL for the host name).
+  * @return TRUE on success, FALSE if the collector could not be resolved.
+  */
+u8_t initExport(const char* target, const char* node);
+
+/**
+  * @brief Send the snapshot of a thread to the collector, a datagram per metric.
+  * @details Every snapshot holds the statistics and histogram since the start
+  *          of the run, so that a lost datagram is made up for by the next one.
+  *          Should only be called by the non-RT threads.
+  * @param thread The results of the thread (from a snapshot of its statistics).
+  * @param num_threads The number of measurement threads of the run.
+  * @param sequence The number of the report.
+  * @param done Whether these are the final results of the thread.
+  * @return Void.
+  */
+void exportSnapshot(const summary_thread_t* thread, u32_t num_threads, u64_t sequence, u8_t done);
+
+/**
+  * @brief Close the socket of the collector (if open).
+  * @return Void.
+  */
+void closeExport(void);
+
+/*****************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* SCHED_EXPORT_H */
@@ -0,0 +1,396 @@
+/**
+  * @file sched_interference.c
+  * @brief Implements the interference counters (context switches, interrupts,
+  *        SMIs and perf_event counters), which tell what a latency spike was
+  *        caused by.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+#define _GNU_SOURCE
+
+/******************************** Inclusions *********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "sched_interference.h"
+
+/***************************** Macro Definitions *****************************/
+
+/** The maximum size of the interrupts file. */
+#define INTERRUPTS_SIZE (256u * 1024u)
+
+/** The file the interrupt counters are read from. */
+#define INTERRUPTS_FILE "/proc/interrupts"
+
+/** The MSR that counts the SMIs (MSR_SMI_COUNT). */
+#define MSR_SMI_COUNT (0x34)
+
+/** The upper bound of each latency band but the last in nsec. */
+#define BAND_LIMIT_0 (10u * NSEC_PER_USEC)
+#define BAND_LIMIT_1 (100u * NSEC_PER_USEC)
+#define BAND_LIMIT_2 (NSEC_PER_MSEC)
+
+/***************************** Static Variables ******************************/
+
+/** The names of the latency bands. */
+static const char* const band_names[INTERFERENCE_BANDS] = { "<10us", "<100us", "<1ms", ">=1ms" };
+
+/** The names of the perf_event counters. */
+static const char* const perf_names[PERF_COUNTERS] = { "cycles", "cache_misses", "tlb_misses" };
+
+/** The contents of the interrupts file (too large for the stack of the reporter). */
+static char interrupts_data[INTERRUPTS_SIZE];
+
+/************************ Static Function Prototypes *************************/
+
+/**
+  * @brief Open a perf_event counter for the calling thread.
+  * @param counter The counter to open.
+  * @return The file descriptor, -1 if the counter is not available.
+  */
+static int openPerfCounter(perf_counter_t counter);
+
+/**
+  * @brief Read the counters of the calling thread.
+  * @param interference The interference context of the thread.
+  * @param counters The counters to fill.
+  * @return Void.
+  */
+static void readCounters(const interference_t* interference, interference_counters_t* counters);
+
+/**
+  * @brief Add the difference of two readings to a sum of counters.
+  * @param sum The sum to add to.
+  * @param now The current reading.
+  * @param last The previous reading.
+  * @return Void.
+  */
+static void addCounters(interference_counters_t* sum, const interference_counters_t* now,
+                        const interference_counters_t* last);
+
+/**
+  * @brief Add the counters since the last capture to the highest band in between.
+  * @param interference The interference context of the thread.
+  * @return Void.
+  */
+static void captureCounters(interference_t* interference);
+
+/***************************** Static Functions ******************************/
+
+int openPerfCounter(perf_counter_t counter)
+{
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.exclude_hv = 1;
+
+  switch (counter)
+  {
+    case PERF_COUNTER_CYCLES:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+
+    case PERF_COUNTER_CACHE_MISSES:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CACHE_MISSES;
+      break;
+
+    case PERF_COUNTER_TLB_MISSES:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      break;
+
+    default:
+      return -1;
+  }
+
+  /* The calling thread on any CPU, since glibc has no wrapper. */
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+void readCounters(const interference_t* interference, interference_counters_t* counters)
+{
+  struct rusage usage;
+  u32_t i;
+
+  if (getrusage(RUSAGE_THREAD, &usage) == 0)
+  {
+    counters->voluntary = (u64_t)usage.ru_nvcsw;
+    counters->involuntary = (u64_t)usage.ru_nivcsw;
+  }
+
+  for (i = 0u; i < PERF_COUNTERS; i++)
+    if ((interference->perf_fds[i] < 0) ||
+        (read(interference->perf_fds[i], &counters->perf[i], sizeof(counters->perf[i])) != sizeof(counters->perf[i])))
+      counters->perf[i] = 0u;
+}
+
+void addCounters(interference_counters_t* sum, const interference_counters_t* now,
+                 const interference_counters_t* last)
+{
+  u32_t i;
+
+  sum->voluntary += now->voluntary - last->voluntary;
+  sum->involuntary += now->involuntary - last->involuntary;
+
+  for (i = 0u; i < PERF_COUNTERS; i++)
+    sum->perf[i] += now->perf[i] - last->perf[i];
+}
+
+void captureCounters(interference_t* interference)
+{
+  interference_counters_t now;
+
+  readCounters(interference, &now);
+
+  addCounters(&interference->bands[interference->worst_band], &now, &interference->last);
+  addCounters(&interference->total, &now, &interference->last);
+
+  interference->last = now;
+  interference->worst_band = 0u;
+}
+
+/***************************** Public Functions ******************************/
+
+u8_t initInterference(interference_t* interference, u8_t perf, u64_t threshold)
+{
+  u8_t opened = TRUE;
+  u32_t i;
+
+  interference->has_perf = FALSE;
+
+  memset(interference->bands, 0, sizeof(interference->bands));
+  memset(interference->band_cycles, 0, sizeof(interference->band_cycles));
+  memset(&interference->total, 0, sizeof(interference->total));
+  memset(&interference->last, 0, sizeof(interference->last));
+  interference->worst_band = 0u;
+  interference->recapture = FALSE;
+  interference->request = 0u;
+  interference->threshold = (s64_t)threshold;
+  interference->cycles = 0u;
+  interference->recaptured = 0u;
+
+  for (i = 0u; i < PERF_COUNTERS; i++)
+  {
+    interference->perf_fds[i] = perf ? openPerfCounter((perf_counter_t)i) : -1;
+    if (interference->perf_fds[i] >= 0)
+      interference->has_perf = TRUE;
+    else if (perf)
+      opened = FALSE;
+  }
+
+  readCounters(interference, &interference->last);
+
+  return opened;
+}
+
+void updateInterference(interference_t* interference, s64_t latency, u32_t request)
+{
+  u32_t band;
+  u8_t outlier;
+
+  if (latency < (s64_t)BAND_LIMIT_0)
+    band = 0u;
+  else if (latency < (s64_t)BAND_LIMIT_1)
+    band = 1u;
+  else if (latency < (s64_t)BAND_LIMIT_2)
+    band = 2u;
+  else
+    band = 3u;
+
+  interference->band_cycles[band]++;
+  interference->cycles++;
+  if (band > interference->worst_band)
+    interference->worst_band = band;
+
+  outlier = ((interference->threshold > 0) && (latency > interference->threshold)) ? TRUE : FALSE;
+
+  /* An outlier is captured along with the cycle after it, so that the quiet cycles that follow
+   * do not add up to its band, unless a burst of outliers would read the counters every cycle. */
+  if (interference->recapture || outlier || (request != interference->request))
+  {
+    captureCounters(interference);
+
+    if (interference->recapture)
+    {
+      interference->recapture = FALSE;
+      interference->recaptured = interference->cycles;
+    }
+    else if (outlier && ((interference->recaptured == 0u) ||
+                         (interference->cycles - interference->recaptured >= INTERFERENCE_RECAPTURE_CYCLES)))
+      interference->recapture = TRUE;
+
+    interference->request = request;
+  }
+}
+
+void closeInterference(interference_t* interference)
+{
+  u32_t i;
+
+  captureCounters(interference);
+
+  for (i = 0u; i < PERF_COUNTERS; i++)
+  {
+    if (interference->perf_fds[i] >= 0)
+      close(interference->perf_fds[i]);
+
+    interference->perf_fds[i] = -1;
+  }
+}
+
+u8_t readInterrupts(u64_t* counts, u32_t max_cpus)
+{
+  u32_t columns[MAX_INTERRUPT_CPUS];
+  u32_t num_columns = 0u, column;
+  const char* cur;
+  const char* end;
+  const char* data_end;
+  ssize_t bytes;
+  u64_t size = 0u, value;
+  int fd;
+
+  memset(counts, 0, sizeof(*counts) * max_cpus);
+
+  if ((fd = open(INTERRUPTS_FILE, O_RDONLY)) < 0)
+    return FALSE;
+
+  while ((size < sizeof(interrupts_data)) &&
+         ((bytes = read(fd, interrupts_data + size, sizeof(interrupts_data) - size)) > 0))
+    size += (u64_t)bytes;
+
+  close(fd);
+
+  cur = interrupts_data;
+  data_end = interrupts_data + size;
+
+  /* The header names the CPU of each column (offline CPUs have none). */
+  if ((end = memchr(cur, '\n', (size_t)(data_end - cur))) == NULL)
+    return FALSE;
+
+  for (; (cur = memmem(cur, (size_t)(end - cur), "CPU", 3u)) != NULL; cur += 3)
+  {
+    if (num_columns < MAX_INTERRUPT_CPUS)
+      columns[num_columns++] = (u32_t)strtoul(cur + 3, NULL, 10);
+  }
+
+  /* Every other line has a label, followed by one counter per column. */
+  for (cur = end + 1; cur < data_end; cur = end + 1)
+  {
+    if ((end = memchr(cur, '\n', (size_t)(data_end - cur))) == NULL)
+      end = data_end;
+
+    if (((cur = memchr(cur, ':', (size_t)(end - cur))) == NULL))
+    {
+      cur = end;
+      continue;
+    }
+
+    for (cur++, column = 0u; column < num_columns; column++)
+    {
+      while ((cur < end) && (*cur == ' '))
+        cur++;
+
+      if ((cur >= end) || (*cur < '0') || (*cur > '9'))
+        break;
+
+      for (value = 0u; (cur < end) && (*cur >= '0') && (*cur <= '9'); cur++)
+        value = (value * 10u) + (u64_t)(*cur - '0');
+
+      if (columns[column] < max_cpus)
+        counts[columns[column]] += value;
+    }
+  }
+
+  return TRUE;
+}
+
+u8_t readSmiCount(u32_t cpu, u64_t* count)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  char path[64];
+  u64_t value;
+  int fd;
+
+  snprintf(path, sizeof(path), "/dev/cpu/%u/msr", cpu);
+
+  if ((fd = open(path, O_RDONLY)) < 0)
+    return FALSE;
+
+  if (pread(fd, &value, sizeof(value), MSR_SMI_COUNT) != sizeof(value))
+  {
+    close(fd);
+    return FALSE;
+  }
+
+  close(fd);
+
+  /* The counter is 32 bits wide. */
+  *count = value & U32_MAX;
+
+  return TRUE;
+#else
+  (void)cpu;
+  (void)count;
+
+  return FALSE;
+#endif
+}
+
+void printInterference(const interference_t* interference, u32_t id, u32_t cpu)
+{
+  const interference_counters_t* band;
+  u32_t i, j;
+
+  printf("\nT:%2u CPU:%3u IRQs: %llu SMIs: ", id, cpu, interference->irqs_end - interference->irqs_start);
+  if (interference->has_smis)
+    printf("%llu", (interference->smis_end - interference->smis_start) & U32_MAX);
+  else
+    printf("n/a");
+  printf(" Voluntary CSW: %llu Involuntary CSW: %llu\n",
+         interference->total.voluntary, interference->total.involuntary);
+
+  printf("T:%2u %-8s %10s %12s %12s", id, "Latency", "Cycles", "Invol. CSW", "Vol. CSW");
+  for (j = 0u; interference->has_perf && (j < PERF_COUNTERS); j++)
+    printf(" %14s", perf_names[j]);
+  printf("\n");
+
+  /* The average interference of a cycle of each latency band. */
+  for (i = 0u; i < INTERFERENCE_BANDS; i++)
+  {
+    if (interference->band_cycles[i] == 0u)
+      continue;
+
+    band = &interference->bands[i];
+
+    printf("T:%2u %-8s %10llu %12.3f %12.3f", id, band_names[i], interference->band_cycles[i],
+           (f64_t)band->involuntary / interference->band_cycles[i],
+           (f64_t)band->voluntary / interference->band_cycles[i]);
+    for (j = 0u; interference->has_perf && (j < PERF_COUNTERS); j++)
+      printf(" %14.1f", (f64_t)band->perf[j] / interference->band_cycles[i]);
+    printf("\n");
+  }
+}
+
+const char* getInterferenceBandName(u32_t band)
+{
+  return (band < INTERFERENCE_BANDS) ? band_names[band] : "";
+}
+
+const char* getPerfCounterName(perf_counter_t counter)
+{
+  return (counter < PERF_COUNTERS) ? perf_names[counter] : "";
+}
@@ -0,0 +1,167 @@
+/**
+  * @file sched_interference.h
+  * @brief Contains the declarations of functions defined in sched_interference.c.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+#ifndef SCHED_INTERFERENCE_H
+#define SCHED_INTERFERENCE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************** Inclusions *********************************/
+
+#include <stdio.h>
+
+#include "data_types.h"
+#include "sched_statistics.h"
+
+/***************************** Macro Definitions *****************************/
+
+/** The latency bands the interference is correlated with (< 10us, < 100us, < 1ms, >= 1ms). */
+#define INTERFERENCE_BANDS (4u)
+
+/** The fewest cycles between two captures after an outlier. */
+#define INTERFERENCE_RECAPTURE_CYCLES (1000u)
+
+/** The most CPUs whose interrupts are counted. */
+#define MAX_INTERRUPT_CPUS (1024u)
+
+/***************************** Type Definitions ******************************/
+
+/** The perf_event counters of a measurement thread. */
+typedef enum
+{
+  PERF_COUNTER_CYCLES,        /**< The CPU cycles spent by the thread. */
+  PERF_COUNTER_CACHE_MISSES,  /**< The last level cache misses of the thread. */
+  PERF_COUNTER_TLB_MISSES,    /**< The data TLB misses of the thread. */
+  PERF_COUNTERS
+} perf_counter_t;
+
+/** The counters of the interference a thread is exposed to. */
+typedef struct
+{
+  u64_t voluntary;              /**< The voluntary context switches (the thread slept). */
+  u64_t involuntary;            /**< The involuntary context switches (the thread was preempted). */
+  u64_t perf[PERF_COUNTERS];    /**< The perf_event counters (0 if not available). */
+} interference_counters_t;
+
+/** The interference context of a measurement thread.
+  * The thread counts the latency band of every cycle, but only reads its own
+  * counters when a capture is requested and around the cycles above the
+  * threshold, while the system-wide counters are sampled by the main thread.
+  */
+typedef struct
+{
+  int perf_fds[PERF_COUNTERS];      /**< The perf_event counters (-1 if not opened). */
+  u8_t has_perf;                    /**< Whether any perf_event counter was opened. */
+
+  interference_counters_t last;     /**< The counters at the last capture. */
+  interference_counters_t total;    /**< The counters since the first cycle. */
+
+  u64_t band_cycles[INTERFERENCE_BANDS];             /**< The cycles of each latency band. */
+  interference_counters_t bands[INTERFERENCE_BANDS]; /**< The interference of the cycles of each band. */
+  u32_t worst_band;   /**< The highest band of a cycle since the last capture. */
+  u8_t recapture;     /**< Whether the cycle after an outlier is captured as well. */
+  u32_t request;      /**< The last capture request that was served. */
+  s64_t threshold;    /**< The latency of a cycle that is captured in nsec (0 for none). */
+  u64_t cycles;       /**< The cycles counted so far. */
+  u64_t recaptured;   /**< The cycle of the last capture after an outlier. */
+
+  u64_t irqs_start;   /**< The interrupts of the CPU of the thread at the start. */
+  u64_t irqs_end;     /**< The interrupts of the CPU of the thread at the end. */
+  u64_t smis_start;   /**< The SMIs of the CPU of the thread at the start. */
+  u64_t smis_end;     /**< The SMIs of the CPU of the thread at the end. */
+  u8_t has_smis;      /**< Whether the SMI count could be read. */
+} __attribute__((aligned(CACHE_LINE_SIZE))) interference_t;
+
+/***************************** Public Functions ******************************/
+
+/**
+  * @brief Start tracking the interference of the calling thread.
+  * @details The context switches are read through getrusage(RUSAGE_THREAD)
+  *          and the perf counters are opened for the calling thread only,
+  *          so this should be called by the measurement thread itself.
+  * @param interference The interference context of the thread.
+  * @param perf Whether to open the perf_event counters as well.
+  * @param threshold The latency of a cycle whose interference is captured at once
+  *        in nsec (0 to only capture on request).
+  * @return TRUE if every requested perf counter could be opened, FALSE otherwise.
+  */
+u8_t initInterference(interference_t* interference, u8_t perf, u64_t threshold);
+
+/**
+  * @brief Count a cycle in the band of its latency, and capture the counters if due.
+  * @details A capture costs a getrusage() and a read() per perf counter, so the
+  *          counters are only read when a new capture is requested (e.g. on a
+  *          report) and on the cycles above the threshold, and on the cycle after
+  *          them (at most every INTERFERENCE_RECAPTURE_CYCLES).
+  *          The interference since the last capture is added to the highest
+  *          band of a cycle in between. Should be called after the timestamp
+  *          of the cycle is taken.
+  * @param interference The interference context of the thread.
+  * @param latency The latency of the cycle in nsec.
+  * @param request The current capture request (a counter that is advanced to request one).
+  * @return Void.
+  */
+void updateInterference(interference_t* interference, s64_t latency, u32_t request);
+
+/**
+  * @brief Capture the counters a last time, and close the perf_event counters of a thread.
+  * @details Should be called by the measurement thread itself.
+  * @param interference The interference context of the thread.
+  * @return Void.
+  */
+void closeInterference(interference_t* interference);
+
+/**
+  * @brief Read the interrupts each CPU has served since boot.
+  * @param counts The interrupts of each CPU (zeroed first).
+  * @param max_cpus The number of CPUs in counts.
+  * @return TRUE on success, FALSE if /proc/interrupts could not be read.
+  */
+u8_t readInterrupts(u64_t* counts, u32_t max_cpus);
+
+/**
+  * @brief Read the SMI count of a CPU (MSR 0x34, x86 only).
+  * @details Needs the msr module and root privileges.
+  * @param cpu The CPU to read.
+  * @param count The SMIs since boot.
+  * @return TRUE on success, FALSE if the MSR could not be read.
+  */
+u8_t readSmiCount(u32_t cpu, u64_t* count);
+
+/**
+  * @brief Print the interference of a thread, and its correlation with the latency.
+  * @param interference The interference context of the thread.
+  * @param id The index of the thread.
+  * @param cpu The CPU of the thread.
+  * @return Void.
+  */
+void printInterference(const interference_t* interference, u32_t id, u32_t cpu);
+
+/**
+  * @brief Get the name of a latency band.
+  * @param band The index of the band.
+  * @return The name (e.g. "<100us").
+  */
+const char* getInterferenceBandName(u32_t band);
+
+/**
+  * @brief Get the name of a perf_event counter.
+  * @param counter The counter.
+  * @return The name (e.g. "cache_misses").
+  */
+const char* getPerfCounterName(perf_counter_t counter);
+
+/*****************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* SCHED_INTERFERENCE_H */
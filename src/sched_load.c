@@ -0,0 +1,328 @@
+/**
+  * @file sched_load.c
+  * @brief Implements the background load threads, used to measure
+  *        the latency of the measurement threads under a reproducible load.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+/******************************** Inclusions *********************************/
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include "sched_load.h"
+#include "sched_statistics.h"
+
+/***************************** Macro Definitions *****************************/
+
+/** The memory loads are sized this many times the last level cache. */
+#define LOAD_CACHE_FACTOR (4u)
+
+/** The minimum and fallback size of the buffers of the memory loads. */
+#define LOAD_MIN_SIZE (8u * 1024u * 1024u)
+
+/** The maximum default size, since every buffer is locked in memory. */
+#define LOAD_MAX_SIZE (256u * 1024u * 1024u)
+
+/** The size of each mapping of the mmap storm. */
+#define LOAD_MMAP_SIZE (64u * 1024u)
+
+/** The number of iterations of the spin loads between two checks of the stop flag. */
+#define LOAD_SPIN_LOOPS (100000u)
+
+/** The stack size of the load threads (all memory is locked). */
+#define LOAD_STACK_SIZE (64u * 1024u + PTHREAD_STACK_MIN)
+
+/** The period the start polls the load threads with (in nsec). */
+#define LOAD_READY_PERIOD (NSEC_PER_MSEC)
+
+/***************************** Type Definitions ******************************/
+
+/** The state of a load thread. */
+typedef struct
+{
+  load_spec_t spec;   /**< The load to generate. */
+  u64_t size;         /**< The size of the buffers of a memory load. */
+  pthread_t thread;   /**< The handle of the thread. */
+} load_context_t;
+
+/***************************** Static Variables ******************************/
+
+/** The names of the loads, indexed by their type. */
+static const char* const load_names[] = { "cpu", "fp", "memcpy", "chase", "mmap" };
+
+/** The state of each load thread. */
+static load_context_t loads_running[MAX_LOAD_THREADS];
+static u32_t num_loads_running;
+
+/** Whether the load threads should keep running. */
+static u8_t load_running;
+
+/** The number of load threads that are ready to generate load. */
+static u32_t load_ready;
+
+/** Set by a load thread that could not allocate its buffer. */
+static u8_t load_failed;
+
+/************************ Static Function Prototypes *************************/
+
+/**
+  * @brief Get the default size of the buffers of the memory loads.
+  * @return A size larger than the last level cache in bytes.
+  */
+static u64_t getDefaultLoadSize(void);
+
+/**
+  * @brief Check whether the load should keep running.
+  * @return TRUE while the measurement runs.
+  */
+static u8_t isLoadRunning(void);
+
+/**
+  * @brief Generate a kind of load until stopped.
+  * @param load The load to generate.
+  * @param buffer The buffer of a memory load (NULL otherwise).
+  * @return Void.
+  */
+static void generateLoad(const load_context_t* load, u8_t* buffer);
+
+/**
+  * @brief The entry point of a load thread.
+  * @param ptr The state of the load thread.
+  * @return NULL.
+  */
+static void* LOAD_TASK(void* ptr);
+
+/***************************** Static Functions ******************************/
+
+u64_t getDefaultLoadSize(void)
+{
+  long llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+
+  if (llc <= 0)
+    llc = sysconf(_SC_LEVEL2_CACHE_SIZE);
+
+  if ((llc <= 0) || (((u64_t)llc * LOAD_CACHE_FACTOR) < LOAD_MIN_SIZE))
+    return LOAD_MIN_SIZE;
+
+  if (((u64_t)llc * LOAD_CACHE_FACTOR) > LOAD_MAX_SIZE)
+    return LOAD_MAX_SIZE;
+
+  return (u64_t)llc * LOAD_CACHE_FACTOR;
+}
+
+u8_t isLoadRunning(void)
+{
+  return __atomic_load_n(&load_running, __ATOMIC_RELAXED);
+}
+
+void generateLoad(const load_context_t* load, u8_t* buffer)
+{
+  const u64_t half = load->size / 2u;
+  const u64_t slots = load->size / sizeof(u64_t);
+  volatile u64_t int_sink = 0u;
+  volatile f64_t fp_sink = 1.0;
+  u64_t* next = (u64_t*)buffer;
+  u64_t i, j, seed, position;
+  f64_t value;
+  u8_t* mapping;
+
+  switch (load->spec.type)
+  {
+    case LOAD_TYPE_CPU:
+      while (isLoadRunning())
+        for (i = 0u; i < LOAD_SPIN_LOOPS; i++)
+          int_sink = (int_sink * 6364136223846793005ull) + i;
+      break;
+
+    case LOAD_TYPE_FP:
+      while (isLoadRunning())
+      {
+        value = fp_sink;
+        for (i = 0u; i < LOAD_SPIN_LOOPS; i++)
+          value = (value * 1.000001) + (1.0 / (value + 1.0));
+        fp_sink = value;
+      }
+      break;
+
+    case LOAD_TYPE_MEMCPY:
+      /* Copy one half of the buffer to the other, streaming through the LLC. */
+      while (isLoadRunning())
+        memcpy(buffer + half, buffer, half);
+      break;
+
+    case LOAD_TYPE_CHASE:
+      /* Link the slots in a random cycle (Sattolo), so that every access misses. */
+      for (i = 0u; i < slots; i++)
+        next[i] = i;
+
+      for (i = slots - 1u, seed = 88172645463325252ull; i > 0u; i--)
+      {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        j = seed % i;
+        position = next[i];
+        next[i] = next[j];
+        next[j] = position;
+      }
+
+      position = 0u;
+      while (isLoadRunning())
+        for (i = 0u; i < LOAD_SPIN_LOOPS; i++)
+          position = next[position];
+
+      int_sink = position;
+      break;
+
+    case LOAD_TYPE_MMAP:
+      /* Every munmap flushes the TLBs of all CPUs running this process. */
+      while (isLoadRunning())
+      {
+        mapping = mmap(NULL, LOAD_MMAP_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping == MAP_FAILED)
+          continue;
+
+        for (i = 0u; i < LOAD_MMAP_SIZE; i += 4096u)
+          mapping[i] = (u8_t)i;
+
+        (void)munmap(mapping, LOAD_MMAP_SIZE);
+      }
+      break;
+  }
+
+  (void)int_sink;
+}
+
+void* LOAD_TASK(void* ptr)
+{
+  load_context_t* load = (load_context_t*)ptr;
+  u8_t* buffer = NULL;
+
+  if ((load->spec.type == LOAD_TYPE_MEMCPY) || (load->spec.type == LOAD_TYPE_CHASE))
+  {
+    /* Touch the buffer before the start (on the CPU of the load), so that no page faults during the run. */
+    if ((buffer = (u8_t*)malloc(load->size)) != NULL)
+      memset(buffer, 0x5a, load->size);
+    else
+      __atomic_store_n(&load_failed, TRUE, __ATOMIC_RELAXED);
+  }
+
+  __atomic_add_fetch(&load_ready, 1u, __ATOMIC_RELEASE);
+
+  if ((buffer != NULL) || ((load->spec.type != LOAD_TYPE_MEMCPY) && (load->spec.type != LOAD_TYPE_CHASE)))
+    generateLoad(load, buffer);
+
+  free(buffer);
+
+  return (void*)NULL;
+}
+
+/***************************** Public Functions ******************************/
+
+u8_t getLoadType(const char* name, load_type_t* type)
+{
+  u32_t i;
+
+  for (i = 0u; i < sizeof(load_names) / sizeof(load_names[0]); i++)
+  {
+    if (strcmp(name, load_names[i]) == 0)
+    {
+      *type = (load_type_t)i;
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+const char* getLoadName(load_type_t type)
+{
+  return load_names[type];
+}
+
+u8_t startLoad(const load_spec_t* loads, u32_t count, u64_t size)
+{
+  struct timespec period;
+  pthread_attr_t attr;
+  cpu_set_t mask;
+  u32_t i;
+  int error;
+
+  if (count == 0u)
+    return TRUE;
+
+  if (size == 0u)
+    size = getDefaultLoadSize();
+
+  load_running = TRUE;
+  load_ready = 0u;
+  load_failed = FALSE;
+  num_loads_running = 0u;
+
+  for (i = 0u; i < count; i++)
+  {
+    loads_running[i].spec = loads[i];
+    loads_running[i].size = size;
+
+    /* The load threads are not real-time, they inherit the default policy. */
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, LOAD_STACK_SIZE);
+
+    CPU_ZERO(&mask);
+    CPU_SET(loads[i].cpu, &mask);
+    pthread_attr_setaffinity_np(&attr, sizeof(mask), &mask);
+
+    /* The error is reported through errno, as for the other failures. */
+    if ((error = pthread_create(&loads_running[i].thread, &attr, LOAD_TASK, &loads_running[i])) != 0)
+    {
+      pthread_attr_destroy(&attr);
+      stopLoad();
+      errno = error;
+      return FALSE;
+    }
+
+    pthread_attr_destroy(&attr);
+    num_loads_running++;
+  }
+
+  /* The buffers are allocated and touched before the measurement starts. */
+  nsecToTimespec(LOAD_READY_PERIOD, &period);
+  while (__atomic_load_n(&load_ready, __ATOMIC_ACQUIRE) < num_loads_running)
+    (void)nanosleep(&period, NULL);
+
+  /* A load without its buffer would leave the run unloaded. */
+  if (__atomic_load_n(&load_failed, __ATOMIC_RELAXED))
+  {
+    stopLoad();
+    errno = ENOMEM;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+void stopLoad(void)
+{
+  u32_t i;
+
+  __atomic_store_n(&load_running, FALSE, __ATOMIC_RELAXED);
+
+  for (i = 0u; i < num_loads_running; i++)
+    pthread_join(loads_running[i].thread, NULL);
+
+  num_loads_running = 0u;
+}
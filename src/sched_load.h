@@ -0,0 +1,85 @@
+/**
+  * @file sched_load.h
+  * @brief Contains the declarations of functions defined in sched_load.c.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+#ifndef SCHED_LOAD_H
+#define SCHED_LOAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************** Inclusions *********************************/
+
+#include "data_types.h"
+
+/***************************** Macro Definitions *****************************/
+
+/** The maximum number of background load threads. */
+#define MAX_LOAD_THREADS (64u)
+
+/***************************** Type Definitions ******************************/
+
+/** The kinds of background load. */
+typedef enum
+{
+  LOAD_TYPE_CPU,     /**< Integer spin. */
+  LOAD_TYPE_FP,      /**< Floating point spin. */
+  LOAD_TYPE_MEMCPY,  /**< Streaming memcpy over a buffer larger than the LLC. */
+  LOAD_TYPE_CHASE,   /**< Pointer chasing over a buffer larger than the LLC. */
+  LOAD_TYPE_MMAP     /**< mmap/munmap storm, causing TLB shootdowns. */
+} load_type_t;
+
+/** A background load thread. */
+typedef struct
+{
+  load_type_t type;  /**< The kind of load. */
+  u32_t cpu;         /**< The CPU the load runs on. */
+} load_spec_t;
+
+/***************************** Public Functions ******************************/
+
+/**
+  * @brief Get a kind of load by its name.
+  * @param name The name of the load ("cpu", "fp", "memcpy", "chase" or "mmap").
+  * @param type The kind of load.
+  * @return TRUE on success, FALSE if the name is unknown.
+  */
+u8_t getLoadType(const char* name, load_type_t* type);
+
+/**
+  * @brief Get the name of a kind of load.
+  * @param type The kind of load.
+  * @return The name of the load.
+  */
+const char* getLoadName(load_type_t type);
+
+/**
+  * @brief Start the background load threads.
+  * @details Returns once every load thread has allocated its buffers
+  *          and generates load, so that the measurement starts under load.
+  * @param loads The load threads to start.
+  * @param count The number of load threads.
+  * @param size The size of the buffers of the memory loads in bytes
+  *        (0 to size them past the last level cache).
+  * @return TRUE on success, FALSE if a thread could not be started or allocate its buffer.
+  */
+u8_t startLoad(const load_spec_t* loads, u32_t count, u64_t size);
+
+/**
+  * @brief Stop the background load threads and wait for them.
+  * @return Void.
+  */
+void stopLoad(void);
+
+/*****************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* SCHED_LOAD_H */
@@ -0,0 +1,173 @@
+/**
+  * @file sched_pingpong.c
+  * @brief Implements the handoff between two threads on different cores,
+  *        through a futex, an eventfd, a POSIX semaphore or a spun cache line,
+  *        so that the cross-core wakeup latency can be measured.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+#define _GNU_SOURCE
+
+/******************************** Inclusions *********************************/
+
+#include <string.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "sched_pingpong.h"
+#include "sched_clock.h"
+
+/***************************** Static Variables ******************************/
+
+/** The names of the wakeup mechanisms, indexed by their mode. */
+static const char* const pingpong_names[] = { "futex", "eventfd", "sem", "spin" };
+
+/************************ Static Function Prototypes *************************/
+
+/**
+  * @brief Wake the wakee up after the sequence was advanced.
+  * @param pingpong The handoff of the pair.
+  * @return Void.
+  */
+static void wakePingPong(pingpong_t* pingpong);
+
+/***************************** Static Functions ******************************/
+
+void wakePingPong(pingpong_t* pingpong)
+{
+  const u64_t one = 1u;
+
+  switch (pingpong->mode)
+  {
+    case PINGPONG_MODE_FUTEX:
+      /* glibc has no wrapper, and the futex is never shared with another process. */
+      (void)syscall(SYS_futex, &pingpong->sequence, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+      break;
+
+    case PINGPONG_MODE_EVENTFD:
+      (void)write(pingpong->event_fd, &one, sizeof(one));
+      break;
+
+    case PINGPONG_MODE_SEMAPHORE:
+      (void)sem_post(&pingpong->semaphore);
+      break;
+
+    case PINGPONG_MODE_SPIN:
+      break;
+  }
+}
+
+/***************************** Public Functions ******************************/
+
+u8_t getPingPongMode(const char* name, pingpong_mode_t* mode)
+{
+  u32_t i;
+
+  for (i = 0u; i < sizeof(pingpong_names) / sizeof(pingpong_names[0]); i++)
+  {
+    if (strcmp(name, pingpong_names[i]) == 0)
+    {
+      *mode = (pingpong_mode_t)i;
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+const char* getPingPongName(pingpong_mode_t mode)
+{
+  return pingpong_names[mode];
+}
+
+u8_t initPingPong(pingpong_t* pingpong, pingpong_mode_t mode)
+{
+  memset(pingpong, 0, sizeof(*pingpong));
+  pingpong->mode = mode;
+  pingpong->event_fd = -1;
+
+  if ((mode == PINGPONG_MODE_EVENTFD) && ((pingpong->event_fd = eventfd(0u, EFD_CLOEXEC)) < 0))
+    return FALSE;
+
+  if ((mode == PINGPONG_MODE_SEMAPHORE) && (sem_init(&pingpong->semaphore, 0, 0u) != 0))
+    return FALSE;
+
+  return TRUE;
+}
+
+s64_t signalPingPong(pingpong_t* pingpong)
+{
+  const s64_t stamp = getClockNsec();
+
+  /* The release publishes the stamp to the wakee along with the sequence. */
+  __atomic_store_n(&pingpong->stamp, stamp, __ATOMIC_RELAXED);
+  (void)__atomic_add_fetch(&pingpong->sequence, 1u, __ATOMIC_RELEASE);
+
+  wakePingPong(pingpong);
+
+  return stamp;
+}
+
+u8_t waitPingPong(pingpong_t* pingpong, s64_t* stamp)
+{
+  u64_t count;
+  u32_t sequence;
+
+  /* A stale wakeup (e.g. the token of a coalesced handoff) finds no new sequence, and waits again. */
+  while ((sequence = __atomic_load_n(&pingpong->sequence, __ATOMIC_ACQUIRE)) == pingpong->received)
+  {
+    switch (pingpong->mode)
+    {
+      case PINGPONG_MODE_FUTEX:
+        /* Returns at once if the sequence has moved on since it was read. */
+        (void)syscall(SYS_futex, &pingpong->sequence, FUTEX_WAIT_PRIVATE, sequence, NULL, NULL, 0);
+        break;
+
+      case PINGPONG_MODE_EVENTFD:
+        (void)read(pingpong->event_fd, &count, sizeof(count));
+        break;
+
+      case PINGPONG_MODE_SEMAPHORE:
+        while ((sem_wait(&pingpong->semaphore) != 0) && (errno == EINTR))
+          ;
+        break;
+
+      case PINGPONG_MODE_SPIN:
+        break;
+    }
+  }
+
+  pingpong->received = sequence;
+
+  if (__atomic_load_n(&pingpong->closed, __ATOMIC_RELAXED))
+    return FALSE;
+
+  *stamp = __atomic_load_n(&pingpong->stamp, __ATOMIC_RELAXED);
+
+  return TRUE;
+}
+
+void closePingPong(pingpong_t* pingpong)
+{
+  __atomic_store_n(&pingpong->closed, TRUE, __ATOMIC_RELAXED);
+  (void)__atomic_add_fetch(&pingpong->sequence, 1u, __ATOMIC_RELEASE);
+
+  wakePingPong(pingpong);
+}
+
+void destroyPingPong(pingpong_t* pingpong)
+{
+  if (pingpong->event_fd >= 0)
+    close(pingpong->event_fd);
+
+  if (pingpong->mode == PINGPONG_MODE_SEMAPHORE)
+    (void)sem_destroy(&pingpong->semaphore);
+
+  pingpong->event_fd = -1;
+}
@@ -0,0 +1,116 @@
+/**
+  * @file sched_pingpong.h
+  * @brief Contains the declarations of functions defined in sched_pingpong.c.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+#ifndef SCHED_PINGPONG_H
+#define SCHED_PINGPONG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************** Inclusions *********************************/
+
+#include <semaphore.h>
+
+#include "data_types.h"
+#include "sched_statistics.h"
+
+/***************************** Type Definitions ******************************/
+
+/** The mechanisms a thread wakes the other thread of its pair through. */
+typedef enum
+{
+  PINGPONG_MODE_FUTEX,      /**< FUTEX_WAKE on the sequence the wakee waits on. */
+  PINGPONG_MODE_EVENTFD,    /**< A write to an eventfd the wakee reads from. */
+  PINGPONG_MODE_SEMAPHORE,  /**< sem_post of a POSIX semaphore (unnamed). */
+  PINGPONG_MODE_SPIN        /**< A store to the cache line the wakee spins on. */
+} pingpong_mode_t;
+
+/** The handoff between the two threads of a pair.
+  * The waker writes the stamp and the sequence, which share a cache line,
+  * so that a handoff moves a single line to the core of the wakee.
+  */
+typedef struct
+{
+  pingpong_mode_t mode;  /**< The wakeup mechanism. */
+  int event_fd;          /**< The eventfd (-1 if not used). */
+  sem_t semaphore;       /**< The semaphore (only initialized if used). */
+
+  u32_t sequence __attribute__((aligned(CACHE_LINE_SIZE)));  /**< The handoffs (and the close) so far. */
+  u32_t closed;          /**< Set by the waker at the end of the run. */
+  s64_t stamp;           /**< The time of the last handoff in nsec. */
+
+  u32_t received __attribute__((aligned(CACHE_LINE_SIZE)));  /**< The sequence the wakee has seen (its own line). */
+} __attribute__((aligned(CACHE_LINE_SIZE))) pingpong_t;
+
+/***************************** Public Functions ******************************/
+
+/**
+  * @brief Get a wakeup mechanism by its name.
+  * @param name The name of the mechanism ("futex", "eventfd", "sem" or "spin").
+  * @param mode The wakeup mechanism.
+  * @return TRUE on success, FALSE if the name is unknown.
+  */
+u8_t getPingPongMode(const char* name, pingpong_mode_t* mode);
+
+/**
+  * @brief Get the name of a wakeup mechanism.
+  * @param mode The wakeup mechanism.
+  * @return The name of the mechanism.
+  */
+const char* getPingPongName(pingpong_mode_t mode);
+
+/**
+  * @brief Initialize the handoff of a pair.
+  * @param pingpong The handoff to initialize.
+  * @param mode The wakeup mechanism.
+  * @return TRUE on success, FALSE if the eventfd or semaphore could not be created.
+  */
+u8_t initPingPong(pingpong_t* pingpong, pingpong_mode_t mode);
+
+/**
+  * @brief Stamp the current time and wake the other thread of the pair.
+  * @details The stamp is taken right before the wakeup, so that the delay
+  *          the wakee measures is the cost of the mechanism and its wakeup.
+  * @param pingpong The handoff of the pair.
+  * @return The stamp in nsec.
+  */
+s64_t signalPingPong(pingpong_t* pingpong);
+
+/**
+  * @brief Wait until the other thread of the pair hands off.
+  * @details Handoffs that were missed while the wakee ran are coalesced,
+  *          i.e. only the stamp of the last one is returned.
+  * @param pingpong The handoff of the pair.
+  * @param stamp The stamp of the handoff in nsec.
+  * @return TRUE on a handoff, FALSE once the pair has been closed.
+  */
+u8_t waitPingPong(pingpong_t* pingpong, s64_t* stamp);
+
+/**
+  * @brief Close the handoff, so that the waiting thread returns.
+  * @param pingpong The handoff of the pair.
+  * @return Void.
+  */
+void closePingPong(pingpong_t* pingpong);
+
+/**
+  * @brief Release the eventfd or semaphore of a handoff.
+  * @details Should only be called once both threads are done.
+  * @param pingpong The handoff of the pair.
+  * @return Void.
+  */
+void destroyPingPong(pingpong_t* pingpong);
+
+/*****************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* SCHED_PINGPONG_H */
@@ -0,0 +1,87 @@
+/**
+  * @file sched_policy.c
+  * @brief Implements the scheduling policies of the measurement threads.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+/******************************** Inclusions *********************************/
+
+#define _GNU_SOURCE
+
+#include <string.h>
+
+#include <unistd.h>
+#include <sched.h>
+#include <sys/syscall.h>
+
+#include "sched_policy.h"
+
+/***************************** Macro Definitions *****************************/
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE (6)
+#endif
+
+/***************************** Type Definitions ******************************/
+
+/** The attributes given to sched_setattr (struct sched_attr of the kernel ABI). */
+typedef struct
+{
+  u32_t size;
+  u32_t sched_policy;
+  u64_t sched_flags;
+  s32_t sched_nice;
+  u32_t sched_priority;
+  u64_t sched_runtime;
+  u64_t sched_deadline;
+  u64_t sched_period;
+} deadline_attr_t;
+
+/***************************** Static Variables ******************************/
+
+/** The names of the policies, indexed by their value. */
+static const char* const policy_names[] = { "fifo", "rr", "deadline" };
+
+/***************************** Public Functions ******************************/
+
+u8_t getSchedPolicy(const char* name, sched_policy_t* policy)
+{
+  u32_t i;
+
+  for (i = 0u; i < sizeof(policy_names) / sizeof(policy_names[0]); i++)
+  {
+    if (strcmp(name, policy_names[i]) == 0)
+    {
+      *policy = (sched_policy_t)i;
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+const char* getSchedPolicyName(sched_policy_t policy)
+{
+  return policy_names[policy];
+}
+
+int getSchedPolicyId(sched_policy_t policy)
+{
+  return (policy == SCHED_POLICY_FIFO) ? SCHED_FIFO : SCHED_RR;
+}
+
+u8_t setDeadlinePolicy(u64_t runtime, u64_t deadline, u64_t period)
+{
+  deadline_attr_t attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.sched_policy = SCHED_DEADLINE;
+  attr.sched_runtime = runtime;
+  attr.sched_deadline = deadline;
+  attr.sched_period = period;
+
+  return (syscall(SYS_sched_setattr, 0, &attr, 0u) == 0) ? TRUE : FALSE;
+}
@@ -0,0 +1,72 @@
+/**
+  * @file sched_policy.h
+  * @brief Contains the declarations of functions defined in sched_policy.c.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+#ifndef SCHED_POLICY_H
+#define SCHED_POLICY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************** Inclusions *********************************/
+
+#include "data_types.h"
+
+/***************************** Type Definitions ******************************/
+
+/** The scheduling policies of the measurement threads. */
+typedef enum
+{
+  SCHED_POLICY_FIFO,     /**< SCHED_FIFO, run until blocked or preempted. */
+  SCHED_POLICY_RR,       /**< SCHED_RR, round-robin among the same priority. */
+  SCHED_POLICY_DEADLINE  /**< SCHED_DEADLINE, earliest deadline first (CBS). */
+} sched_policy_t;
+
+/***************************** Public Functions ******************************/
+
+/**
+  * @brief Get a scheduling policy by its name.
+  * @param name The name of the policy ("fifo", "rr" or "deadline").
+  * @param policy The scheduling policy.
+  * @return TRUE on success, FALSE if the name is unknown.
+  */
+u8_t getSchedPolicy(const char* name, sched_policy_t* policy);
+
+/**
+  * @brief Get the name of a scheduling policy.
+  * @param policy The scheduling policy.
+  * @return The name of the policy.
+  */
+const char* getSchedPolicyName(sched_policy_t policy);
+
+/**
+  * @brief Get the policy of a scheduling policy, as given to the pthread API.
+  * @param policy The scheduling policy (not SCHED_POLICY_DEADLINE).
+  * @return The policy (SCHED_FIFO or SCHED_RR).
+  */
+int getSchedPolicyId(sched_policy_t policy);
+
+/**
+  * @brief Switch the calling thread to SCHED_DEADLINE.
+  * @details SCHED_DEADLINE can only be set through sched_setattr,
+  *          which glibc does not wrap. The kernel only admits the thread
+  *          if its affinity spans its root domain (i.e. it is not pinned).
+  * @param runtime The runtime of each period in nsec.
+  * @param deadline The relative deadline of each period in nsec.
+  * @param period The period in nsec.
+  * @return TRUE on success, FALSE otherwise (errno is set).
+  */
+u8_t setDeadlinePolicy(u64_t runtime, u64_t deadline, u64_t period);
+
+/*****************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* SCHED_POLICY_H */
@@ -0,0 +1,530 @@
+/**
+  * @file sched_preflight.c
+  * @brief Implements the pre-flight checks of the system settings that the
+  *        latency depends on, and the tuning of the system for a run.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+/******************************** Inclusions *********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+
+#include "sched_preflight.h"
+
+/***************************** Macro Definitions *****************************/
+
+/** The directory of the CPUs in sysfs. */
+#define CPU_DIR "/sys/devices/system/cpu"
+
+/** The directory of the IRQs in procfs. */
+#define IRQ_DIR "/proc/irq"
+
+/** The file that holds the CPUs in their shallowest C-state while it is open. */
+#define DMA_LATENCY_FILE "/dev/cpu_dma_latency"
+
+/** The most cpuidle states of a CPU. */
+#define MAX_IDLE_STATES (16u)
+
+/** The most IRQs whose affinity is restored after the run. */
+#define MAX_SAVED_IRQS (1024u)
+
+/** The maximum length of a CPU list. */
+#define CPU_LIST_SIZE (64u)
+
+/** The size of a path under the sysfs and procfs directories (fits any entry name). */
+#define PATH_SIZE (320u)
+
+/** The size of the affinity path of an IRQ (fits any IRQ number). */
+#define IRQ_PATH_SIZE (48u)
+
+/***************************** Type Definitions ******************************/
+
+/** The original affinity of an IRQ that was moved. */
+typedef struct
+{
+  u32_t irq;                     /**< The number of the IRQ. */
+  char path[IRQ_PATH_SIZE];      /**< The affinity file of the IRQ (formatted ahead of the restore). */
+  char affinity[CPU_LIST_SIZE];  /**< The original CPU list of the IRQ. */
+} saved_irq_t;
+
+/***************************** Static Variables ******************************/
+
+/** The results of the checks. */
+static preflight_t preflight;
+
+/** Whether the system has been checked. */
+static u8_t preflight_checked;
+
+/** The open /dev/cpu_dma_latency (-1 if not held). */
+static int dma_latency_fd = -1;
+
+/** The IRQs moved off the measured CPUs. */
+static saved_irq_t saved_irqs[MAX_SAVED_IRQS];
+static u32_t num_saved_irqs;
+
+/** Whether restoreTuning is registered to run at exit. */
+static u8_t restore_registered;
+
+/************************ Static Function Prototypes *************************/
+
+/**
+  * @brief Read the first line of a file, without its newline.
+  * @param path The path of the file.
+  * @param line The buffer to read into.
+  * @param size The size of the buffer.
+  * @return TRUE on success, FALSE if the file could not be read.
+  */
+static u8_t readLine(const char* path, char* line, u32_t size);
+
+/**
+  * @brief Write a string to a file.
+  * @param path The path of the file.
+  * @param value The string to write.
+  * @return TRUE on success, FALSE if the file could not be written.
+  */
+static u8_t writeLine(const char* path, const char* value);
+
+/**
+  * @brief Parse a CPU list (e.g. 0,2-3) into a mask.
+  * @param list The list to parse.
+  * @param mask The mask to fill (cleared first).
+  * @return The number of CPUs in the list.
+  */
+static u32_t parseCpuMask(const char* list, u8_t* mask);
+
+/**
+  * @brief Format a mask as a CPU list.
+  * @param mask The mask to format.
+  * @param list The buffer to write the list to.
+  * @param size The size of the buffer.
+  * @return TRUE on success, FALSE if the mask is empty or the list does not fit.
+  */
+static u8_t formatCpuMask(const u8_t* mask, char* list, u32_t size);
+
+/**
+  * @brief Get the exit latency of the deepest enabled C-state of a CPU.
+  * @param cpu The CPU to check.
+  * @param name The name of the state (left empty without cpuidle).
+  * @param size The size of the name.
+  * @return The exit latency in usec, 0 without cpuidle.
+  */
+static u64_t getIdleLatency(u32_t cpu, char* name, u32_t size);
+
+/**
+  * @brief Check whether an entry of the IRQ directory is an IRQ.
+  * @param name The name of the entry.
+  * @return TRUE if the name is a number.
+  */
+static u8_t isIrq(const char* name);
+
+/***************************** Static Functions ******************************/
+
+u8_t readLine(const char* path, char* line, u32_t size)
+{
+  FILE* file = fopen(path, "r");
+
+  if (file == NULL)
+    return FALSE;
+
+  if (fgets(line, (int)size, file) == NULL)
+    line[0] = '\0';
+
+  fclose(file);
+
+  line[strcspn(line, "\n")] = '\0';
+
+  return TRUE;
+}
+
+u8_t writeLine(const char* path, const char* value)
+{
+  ssize_t length = (ssize_t)strlen(value);
+  u8_t written;
+  int fd;
+
+  if ((fd = open(path, O_WRONLY)) < 0)
+    return FALSE;
+
+  written = (write(fd, value, (size_t)length) == length) ? TRUE : FALSE;
+  close(fd);
+
+  return written;
+}
+
+u32_t parseCpuMask(const char* list, u8_t* mask)
+{
+  const char* cur = list;
+  char* end;
+  u32_t first, last, cpu, count = 0u;
+
+  memset(mask, 0, MAX_PREFLIGHT_CPUS);
+
+  while (isdigit((unsigned char)*cur))
+  {
+    first = last = (u32_t)strtoul(cur, &end, 10);
+
+    if (*end == '-')
+      last = (u32_t)strtoul(end + 1, &end, 10);
+
+    for (cpu = first; (cpu <= last) && (cpu < MAX_PREFLIGHT_CPUS); cpu++)
+    {
+      count += (mask[cpu] == 0u) ? 1u : 0u;
+      mask[cpu] = 1u;
+    }
+
+    cur = (*end == ',') ? end + 1 : end;
+  }
+
+  return count;
+}
+
+u8_t formatCpuMask(const u8_t* mask, char* list, u32_t size)
+{
+  u32_t cpu, last, length = 0u;
+  int written;
+
+  list[0] = '\0';
+
+  for (cpu = 0u; cpu < MAX_PREFLIGHT_CPUS; cpu = last + 1u)
+  {
+    if (!mask[cpu])
+    {
+      last = cpu;
+      continue;
+    }
+
+    for (last = cpu; ((last + 1u) < MAX_PREFLIGHT_CPUS) && mask[last + 1u]; last++)
+      ;
+
+    if (last == cpu)
+      written = snprintf(list + length, size - length, "%s%u", (length > 0u) ? "," : "", cpu);
+    else
+      written = snprintf(list + length, size - length, "%s%u-%u", (length > 0u) ? "," : "", cpu, last);
+
+    if ((written < 0) || ((length + (u32_t)written) >= size))
+      return FALSE;
+
+    length += (u32_t)written;
+  }
+
+  return (length > 0u) ? TRUE : FALSE;
+}
+
+u64_t getIdleLatency(u32_t cpu, char* name, u32_t size)
+{
+  char path[PATH_SIZE], line[32];
+  u64_t latency, deepest = 0u;
+  u32_t state;
+
+  name[0] = '\0';
+
+  for (state = 0u; state < MAX_IDLE_STATES; state++)
+  {
+    snprintf(path, sizeof(path), CPU_DIR "/cpu%u/cpuidle/state%u/disable", cpu, state);
+    if (!readLine(path, line, sizeof(line)))
+      break;
+
+    if (strcmp(line, "0") != 0)
+      continue;
+
+    snprintf(path, sizeof(path), CPU_DIR "/cpu%u/cpuidle/state%u/latency", cpu, state);
+    if (!readLine(path, line, sizeof(line)))
+      continue;
+
+    if ((latency = strtoull(line, NULL, 10)) >= deepest)
+    {
+      deepest = latency;
+      snprintf(path, sizeof(path), CPU_DIR "/cpu%u/cpuidle/state%u/name", cpu, state);
+      if (!readLine(path, name, size))
+        name[0] = '\0';
+    }
+  }
+
+  return deepest;
+}
+
+u8_t isIrq(const char* name)
+{
+  if (*name == '\0')
+    return FALSE;
+
+  for (; *name != '\0'; name++)
+    if (!isdigit((unsigned char)*name))
+      return FALSE;
+
+  return TRUE;
+}
+
+/***************************** Public Functions ******************************/
+
+u32_t checkPreflight(const u32_t* cpus, u32_t num_cpus)
+{
+  static u8_t isolated[MAX_PREFLIGHT_CPUS], nohz_full[MAX_PREFLIGHT_CPUS];
+  static u8_t measured[MAX_PREFLIGHT_CPUS], affinity[MAX_PREFLIGHT_CPUS];
+  char path[PATH_SIZE], line[256], governor[32], idle_name[32];
+  struct dirent* entry;
+  u64_t idle_latency;
+  s64_t rt_period = 0;
+  u32_t i, cpu;
+  DIR* dir;
+
+  memset(&preflight, 0, sizeof(preflight));
+  preflight.rt_runtime = -1;
+
+  memset(measured, 0, sizeof(measured));
+  for (i = 0u; i < num_cpus; i++)
+    if (cpus[i] < MAX_PREFLIGHT_CPUS)
+      measured[cpus[i]] = 1u;
+
+  printf("# Preflight #\n");
+
+  preflight.preempt_rt = (readLine("/sys/kernel/realtime", line, sizeof(line)) && (strcmp(line, "1") == 0)) ? TRUE : FALSE;
+  printf("Kernel: %s\n", preflight.preempt_rt ? "PREEMPT_RT" : "not PREEMPT_RT");
+
+  if (!readLine(CPU_DIR "/isolated", line, sizeof(line)))
+    line[0] = '\0';
+  (void)parseCpuMask(line, isolated);
+
+  if (!readLine(CPU_DIR "/nohz_full", line, sizeof(line)))
+    line[0] = '\0';
+  (void)parseCpuMask(line, nohz_full);
+
+  /* Every measured CPU once, in order. */
+  for (cpu = 0u; cpu < MAX_PREFLIGHT_CPUS; cpu++)
+  {
+    if (!measured[cpu])
+      continue;
+
+    snprintf(path, sizeof(path), CPU_DIR "/cpu%u/cpufreq/scaling_governor", cpu);
+    if (!readLine(path, governor, sizeof(governor)))
+      governor[0] = '\0';
+
+    if (preflight.governor[0] == '\0')
+      strcpy(preflight.governor, governor);
+
+    idle_latency = getIdleLatency(cpu, idle_name, sizeof(idle_name));
+    if (idle_latency > preflight.idle_latency)
+      preflight.idle_latency = idle_latency;
+
+    printf("CPU %u: Governor: %s C-State: %s (%llu us) Isolated: %s nohz_full: %s\n", cpu,
+           (governor[0] != '\0') ? governor : "n/a", (idle_name[0] != '\0') ? idle_name : "n/a",
+           idle_latency, isolated[cpu] ? "yes" : "no", nohz_full[cpu] ? "yes" : "no");
+
+    if ((governor[0] != '\0') && (strcmp(governor, "performance") != 0))
+    {
+      printf("Warning: CPU %u runs the %s governor, its frequency changes under load\n", cpu, governor);
+      preflight.slow_governors++;
+    }
+
+    if (idle_latency > IDLE_LATENCY_LIMIT)
+      printf("Warning: CPU %u may enter %s, which takes %llu us to exit\n", cpu, idle_name, idle_latency);
+
+    if (!isolated[cpu])
+      preflight.not_isolated++;
+
+    if (!nohz_full[cpu])
+      preflight.not_nohz_full++;
+  }
+
+  if (preflight.idle_latency > IDLE_LATENCY_LIMIT)
+    preflight.warnings++;
+
+  preflight.warnings += preflight.slow_governors;
+
+  if (preflight.not_isolated > 0u)
+  {
+    printf("Warning: %u measured CPUs are not in isolcpus, other tasks may run on them\n", preflight.not_isolated);
+    preflight.warnings++;
+  }
+
+  if (preflight.not_nohz_full > 0u)
+    printf("Note: %u measured CPUs are not in nohz_full, the tick keeps running on them\n", preflight.not_nohz_full);
+
+  if (readLine("/proc/sys/kernel/sched_rt_runtime_us", line, sizeof(line)))
+    preflight.rt_runtime = strtoll(line, NULL, 10);
+  if (readLine("/proc/sys/kernel/sched_rt_period_us", line, sizeof(line)))
+    rt_period = strtoll(line, NULL, 10);
+
+  if (preflight.rt_runtime >= 0)
+  {
+    printf("RT Throttling: %lld us per %lld us\n", preflight.rt_runtime, rt_period);
+    printf("Warning: RT throttling is on, the threads are stopped once they exceed the runtime\n");
+    preflight.warnings++;
+  }
+  else
+    printf("RT Throttling: off\n");
+
+  /* The IRQs that may fire on a measured CPU. */
+  if ((dir = opendir(IRQ_DIR)) != NULL)
+  {
+    while ((entry = readdir(dir)) != NULL)
+    {
+      if (!isIrq(entry->d_name))
+        continue;
+
+      snprintf(path, sizeof(path), IRQ_DIR "/%s/smp_affinity_list", entry->d_name);
+      if (!readLine(path, line, sizeof(line)))
+        continue;
+
+      (void)parseCpuMask(line, affinity);
+
+      for (cpu = 0u; cpu < MAX_PREFLIGHT_CPUS; cpu++)
+      {
+        if (affinity[cpu] && measured[cpu])
+        {
+          preflight.shared_irqs++;
+          break;
+        }
+      }
+    }
+
+    closedir(dir);
+  }
+
+  printf("IRQs on Measured CPUs: %u\n", preflight.shared_irqs);
+  if (preflight.shared_irqs > 0u)
+  {
+    printf("Warning: %u IRQs may be served by the measured CPUs (see --tune)\n", preflight.shared_irqs);
+    preflight.warnings++;
+  }
+
+  printf("Warnings: %u\n\n", preflight.warnings);
+
+  preflight_checked = TRUE;
+
+  return preflight.warnings;
+}
+
+void applyTuning(const u32_t* cpus, u32_t num_cpus)
+{
+  static u8_t measured[MAX_PREFLIGHT_CPUS], online[MAX_PREFLIGHT_CPUS], affinity[MAX_PREFLIGHT_CPUS];
+  char path[PATH_SIZE], line[256], moved[CPU_LIST_SIZE];
+  const s32_t zero = 0;
+  struct dirent* entry;
+  u32_t i, cpu, failed = 0u, remaining;
+  u8_t shared;
+  DIR* dir;
+
+  if (!restore_registered)
+  {
+    atexit(restoreTuning);
+    restore_registered = TRUE;
+  }
+
+  /* The CPUs stay in their shallowest C-state as long as the file is open. */
+  if ((dma_latency_fd = open(DMA_LATENCY_FILE, O_RDWR)) >= 0)
+  {
+    if (write(dma_latency_fd, &zero, sizeof(zero)) != sizeof(zero))
+    {
+      close(dma_latency_fd);
+      dma_latency_fd = -1;
+    }
+  }
+
+  preflight.dma_latency_held = (dma_latency_fd >= 0) ? TRUE : FALSE;
+  if (!preflight.dma_latency_held)
+    perror("Could not hold " DMA_LATENCY_FILE);
+
+  memset(measured, 0, sizeof(measured));
+  for (i = 0u; i < num_cpus; i++)
+    if (cpus[i] < MAX_PREFLIGHT_CPUS)
+      measured[cpus[i]] = 1u;
+
+  if (!readLine(CPU_DIR "/online", line, sizeof(line)))
+    line[0] = '\0';
+  (void)parseCpuMask(line, online);
+
+  if ((dir = opendir(IRQ_DIR)) != NULL)
+  {
+    while (((entry = readdir(dir)) != NULL) && (num_saved_irqs < MAX_SAVED_IRQS))
+    {
+      if (!isIrq(entry->d_name))
+        continue;
+
+      snprintf(path, sizeof(path), IRQ_DIR "/%s/smp_affinity_list", entry->d_name);
+      if ((strlen(path) >= IRQ_PATH_SIZE) || !readLine(path, line, sizeof(line)) ||
+          (strlen(line) >= CPU_LIST_SIZE))
+        continue;
+
+      (void)parseCpuMask(line, affinity);
+
+      /* Keep the other CPUs of the IRQ, or spread it over every CPU that is not measured. */
+      for (cpu = 0u, shared = FALSE, remaining = 0u; cpu < MAX_PREFLIGHT_CPUS; cpu++)
+      {
+        if (measured[cpu] && affinity[cpu])
+        {
+          affinity[cpu] = 0u;
+          shared = TRUE;
+        }
+
+        remaining += affinity[cpu];
+      }
+
+      if (!shared)
+        continue;
+
+      for (cpu = 0u; (remaining == 0u) && (cpu < MAX_PREFLIGHT_CPUS); cpu++)
+        affinity[cpu] = (online[cpu] && !measured[cpu]) ? 1u : 0u;
+
+      if (!formatCpuMask(affinity, moved, sizeof(moved)) || !writeLine(path, moved))
+      {
+        failed++;
+        continue;
+      }
+
+      saved_irqs[num_saved_irqs].irq = (u32_t)strtoul(entry->d_name, NULL, 10);
+      strcpy(saved_irqs[num_saved_irqs].path, path);
+      strcpy(saved_irqs[num_saved_irqs].affinity, line);
+      num_saved_irqs++;
+    }
+
+    closedir(dir);
+  }
+
+  preflight.moved_irqs = num_saved_irqs;
+
+  printf("# Tuning #\n");
+  printf("CPU DMA Latency: %s\n", preflight.dma_latency_held ? "held at 0 us" : "not held");
+  printf("Moved IRQs: %u (%u could not be moved)\n", num_saved_irqs, failed);
+
+  /* A SIGKILL (or a crash) skips the restore, so the originals are kept in the log. */
+  if (num_saved_irqs > 0u)
+  {
+    printf("Saved Affinities:");
+    for (i = 0u; i < num_saved_irqs; i++)
+      printf(" %u:%s", saved_irqs[i].irq, saved_irqs[i].affinity);
+    printf("\n");
+  }
+  printf("\n");
+}
+
+void restoreTuning(void)
+{
+  u32_t i;
+
+  if (dma_latency_fd >= 0)
+  {
+    close(dma_latency_fd);
+    dma_latency_fd = -1;
+  }
+
+  /* Only open, write and close, since it may be called from a signal handler. */
+  for (i = 0u; i < num_saved_irqs; i++)
+    (void)writeLine(saved_irqs[i].path, saved_irqs[i].affinity);
+
+  num_saved_irqs = 0u;
+}
+
+const preflight_t* getPreflight(void)
+{
+  return preflight_checked ? &preflight : NULL;
+}
@@ -0,0 +1,93 @@
+/**
+  * @file sched_preflight.h
+  * @brief Contains the declarations of functions defined in sched_preflight.c.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+#ifndef SCHED_PREFLIGHT_H
+#define SCHED_PREFLIGHT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************** Inclusions *********************************/
+
+#include "data_types.h"
+
+/***************************** Macro Definitions *****************************/
+
+/** The most CPUs the checks and the IRQ affinities cover. */
+#define MAX_PREFLIGHT_CPUS (1024u)
+
+/** The exit latency of a C-state above which it inflates the wakeup latency (in usec). */
+#define IDLE_LATENCY_LIMIT (10u)
+
+/***************************** Type Definitions ******************************/
+
+/** The state of the system that the latency depends on. */
+typedef struct
+{
+  char governor[32];           /**< The frequency governor of the first measured CPU ("" without cpufreq). */
+  u32_t slow_governors;        /**< The measured CPUs whose governor is not "performance". */
+  u64_t idle_latency;          /**< The exit latency of the deepest enabled C-state of the measured CPUs in usec. */
+  u32_t not_isolated;          /**< The measured CPUs that are not in isolcpus. */
+  u32_t not_nohz_full;         /**< The measured CPUs that are not in nohz_full. */
+  s64_t rt_runtime;            /**< sched_rt_runtime_us (-1 when RT throttling is off). */
+  u32_t shared_irqs;           /**< The IRQs whose affinity includes a measured CPU. */
+  u8_t preempt_rt;             /**< Whether the kernel is PREEMPT_RT. */
+  u32_t warnings;              /**< The settings that will inflate the latency. */
+
+  u8_t dma_latency_held;       /**< Whether /dev/cpu_dma_latency is held at 0 for the run. */
+  u32_t moved_irqs;            /**< The IRQs moved off the measured CPUs for the run. */
+} preflight_t;
+
+/***************************** Public Functions ******************************/
+
+/**
+  * @brief Check the settings of the system that the latency depends on.
+  * @details Reads the frequency governor, the cpuidle states, isolcpus and
+  *          nohz_full of the measured CPUs, the RT throttling and the IRQ
+  *          affinities, and prints a report with a warning for every setting
+  *          that will inflate the latency.
+  * @param cpus The measured CPUs.
+  * @param num_cpus The number of measured CPUs.
+  * @return The number of warnings.
+  */
+u32_t checkPreflight(const u32_t* cpus, u32_t num_cpus);
+
+/**
+  * @brief Tune the system for the run, until it ends.
+  * @details Holds /dev/cpu_dma_latency at 0, so that no CPU enters a deep
+  *          C-state, and moves every IRQ it can off the measured CPUs.
+  *          Everything is restored by restoreTuning, which is also
+  *          registered to run at exit. The original IRQ affinities are
+  *          printed, since a SIGKILL leaves them moved.
+  * @param cpus The measured CPUs.
+  * @param num_cpus The number of measured CPUs.
+  * @return Void.
+  */
+void applyTuning(const u32_t* cpus, u32_t num_cpus);
+
+/**
+  * @brief Restore the settings changed by applyTuning (if any).
+  * @details Async-signal-safe, so that a signal that kills the run restores them as well.
+  * @return Void.
+  */
+void restoreTuning(void);
+
+/**
+  * @brief Get the results of the checks.
+  * @return The results, NULL if the system was not checked.
+  */
+const preflight_t* getPreflight(void);
+
+/*****************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* SCHED_PREFLIGHT_H */
@@ -10,96 +10,476 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
+#include <math.h>
 
 #include "sched_statistics.h"
+#include "sched_clock.h"
 
-/***************************** Static Variables ******************************/
-
-static struct timespec last_statistics_timer;
-
-static u8_t is_first_cycle = 1u;
+/***************************** Macro Definitions *****************************/
 
-static u64_t number_of_calls;
-
-static f32_t cycle_time;
-static f32_t cur_error;
-static f32_t avg_error = 0.f;
-static f32_t min_error;
-static f32_t max_error = -1.f;
+/** The fixed point shift of the reciprocal of a bucket width. */
+#define BUCKET_SHIFT (63u)
 
 /************************ Static Function Prototypes *************************/
 
 /**
   * @brief Update the errors according to the time delta.
+  * @param stats The statistics of the thread to update.
   * @param time_delta The time difference between the current and previous cycle.
   * @return Void.
   */
-static void updateStatistics(s32_t time_delta);
+static void updateStatistics(sched_statistics_t* stats, s64_t time_delta);
+
+/**
+  * @brief Print the histogram percentiles of a latency metric.
+  * @param out The stream to print to.
+  * @param latency The latency metric to print.
+  * @param name The name of the metric.
+  * @return Void.
+  */
+static void printPercentiles(FILE* out, const latency_statistics_t* latency, const char* name);
+
+/**
+  * @brief Print a latency metric as a single line.
+  * @param latency The latency metric to print.
+  * @param name The name of the metric.
+  * @return Void.
+  */
+static void printLatencySummary(const latency_statistics_t* latency, const char* name);
+
+/**
+  * @brief Mark the start of an update, for the readers of the statistics.
+  * @param stats The statistics context to update.
+  * @return Void.
+  */
+static void beginUpdate(sched_statistics_t* stats);
+
+/**
+  * @brief Mark the end of an update, for the readers of the statistics.
+  * @param stats The statistics context to update.
+  * @return Void.
+  */
+static void endUpdate(sched_statistics_t* stats);
+
+/***************************** Static Variables ******************************/
+
+/** The percentiles reported for each histogram. */
+static const f64_t reported_percentiles[] = { 50.0, 90.0, 99.0, 99.9, 99.99 };
 
 /***************************** Static Functions ******************************/
 
-void updateStatistics(s32_t time_delta)
+void updateStatistics(sched_statistics_t* stats, s64_t time_delta)
 {
-	if (is_first_cycle)
+	s64_t error;
+
+	if (stats->is_first_cycle)
 	{
-		is_first_cycle = 0;
+		stats->is_first_cycle = 0;
 		return;
 	}
 
-	cur_error = cycle_time - time_delta;
-	cur_error = (cur_error >= 0) ? cur_error : -cur_error;
+	error = stats->cycle_time - time_delta;
+	error = (error >= 0) ? error : -error;
+
+	updateLatency(&stats->jitter, error);
+}
+
+void printPercentiles(FILE* out, const latency_statistics_t* latency, const char* name)
+{
+	u32_t i;
+
+	fprintf(out, "Bucket Width: %05.2f us\n", (f64_t)latency->bucket_width / NSEC_PER_USEC);
+	fprintf(out, "Overflow: %llu\n", latency->histogram[HISTOGRAM_BUCKETS]);
+
+	for (i = 0u; i < sizeof(reported_percentiles) / sizeof(reported_percentiles[0]); i++)
+		fprintf(out, "P%g %s: %05.2f us\n", reported_percentiles[i], name,
+		        (f64_t)getPercentile(latency, reported_percentiles[i]) / NSEC_PER_USEC);
+}
 
-	avg_error = ((avg_error * number_of_calls) + cur_error) / (number_of_calls + 1);
-	number_of_calls++;
+void printLatencySummary(const latency_statistics_t* latency, const char* name)
+{
+	const s64_t min_error = (latency->number_of_calls > 0u) ? latency->min_error : 0;
 
-	if (cur_error < min_error)
-		min_error = cur_error;
+	printf("%-6s C:%10llu Avg: %8.2f us Min: %8.2f us P99: %8.2f us P99.99: %8.2f us Max: %8.2f us\n",
+	       name, latency->number_of_calls,
+	       getAverageError(latency) / NSEC_PER_USEC, (f64_t)min_error / NSEC_PER_USEC,
+	       (f64_t)getPercentile(latency, 99.0) / NSEC_PER_USEC,
+	       (f64_t)getPercentile(latency, 99.99) / NSEC_PER_USEC,
+	       (f64_t)latency->max_error / NSEC_PER_USEC);
+}
+
+void beginUpdate(sched_statistics_t* stats)
+{
+	/* Only the owning thread writes the sequence, so a plain increment is enough. */
+	__atomic_store_n(&stats->sequence, stats->sequence + 1u, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
 
-	if (cur_error > max_error)
-		max_error = cur_error;
+void endUpdate(sched_statistics_t* stats)
+{
+	__atomic_store_n(&stats->sequence, stats->sequence + 1u, __ATOMIC_RELEASE);
 }
 
 /***************************** Public Functions ******************************/
 
-void initStatistics(f32_t cycle, s32_t sched_timer_nsec)
+void initLatency(latency_statistics_t* latency, u64_t bucket_width)
+{
+	memset(latency->histogram, 0, sizeof(latency->histogram));
+
+	/* The reciprocal rounded up overestimates a quotient by at most error * (d - 2^63 mod d) / 2^63,
+	 * which stays below a bucket as long as the histogram spans less than 2^63 / d. A power of two
+	 * is exact at any width, so a width too wide for the histogram to span is rounded up to one. */
+	if ((bucket_width & (bucket_width - 1u)) == 0u)
+		latency->bucket_mult = (u64_t)((1ull << BUCKET_SHIFT) / bucket_width);
+	else if ((unsigned __int128)bucket_width * bucket_width * HISTOGRAM_BUCKETS < (1ull << BUCKET_SHIFT))
+		latency->bucket_mult = (u64_t)((1ull << BUCKET_SHIFT) / bucket_width) + 1u;
+	else
+	{
+		while ((bucket_width & (bucket_width - 1u)) != 0u)
+			bucket_width &= bucket_width - 1u;
+		if (bucket_width < (1ull << BUCKET_SHIFT))
+			bucket_width <<= 1u;
+		latency->bucket_mult = (u64_t)((1ull << BUCKET_SHIFT) / bucket_width);
+	}
+
+	latency->bucket_width = bucket_width;
+
+	latency->number_of_calls = 0u;
+
+	latency->cur_error = 0;
+	latency->sum_error = 0u;
+	latency->sum_squares_low = 0u;
+	latency->sum_squares_high = 0u;
+	latency->min_error = S64_MAX;
+	latency->max_error = 0;
+}
+
+void updateLatency(latency_statistics_t* latency, s64_t error)
+{
+	unsigned __int128 squares;
+	u64_t bucket;
+
+	latency->cur_error = error;
+
+	/* The square of any error (e.g. of a stall of seconds) only fits in 128 bits. */
+	squares = (((unsigned __int128)latency->sum_squares_high << 64) | latency->sum_squares_low) +
+	          ((unsigned __int128)(u64_t)error * (u64_t)error);
+	latency->sum_squares_low = (u64_t)squares;
+	latency->sum_squares_high = (u64_t)(squares >> 64);
+
+	latency->sum_error += error;
+	latency->number_of_calls++;
+
+	if (error < latency->min_error)
+		latency->min_error = error;
+
+	if (error > latency->max_error)
+		latency->max_error = error;
+
+	bucket = (u64_t)(((unsigned __int128)(u64_t)error * latency->bucket_mult) >> BUCKET_SHIFT);
+	latency->histogram[(bucket < HISTOGRAM_BUCKETS) ? bucket : HISTOGRAM_BUCKETS]++;
+}
+
+void initStatistics(sched_statistics_t* stats, s64_t cycle, s64_t sched_timer,
+                    u64_t bucket_width, u8_t track_wakeup)
+{
+	beginUpdate(stats);
+
+	initLatency(&stats->jitter, bucket_width);
+	initLatency(&stats->wakeup, bucket_width);
+	initLatency(&stats->handoff, bucket_width);
+
+	/* The response time is only bounded by the cycle, so the histogram spans a whole cycle. */
+	initLatency(&stats->response, (bucket_width * HISTOGRAM_BUCKETS >= (u64_t)cycle) ? bucket_width :
+	                              (((u64_t)cycle + HISTOGRAM_BUCKETS - 1u) / HISTOGRAM_BUCKETS));
+	stats->deadline_misses = 0u;
+	stats->missed_periods = 0u;
+	stats->last_missed = 0;
+	stats->skipped_periods = 0u;
+	stats->track_response = 0u;
+	stats->track_handoff = 0u;
+
+	stats->is_first_cycle = 1u;
+	stats->track_wakeup = track_wakeup;
+	stats->overhead = 0;
+
+	stats->cycle_time = cycle;
+
+	stats->last_timestamp = sched_timer;
+
+	endUpdate(stats);
+}
+
+s64_t getTimestamp(sched_statistics_t* stats, s64_t deadline)
 {
-	cycle_time = cycle;
+	const s64_t timestamp = getClockNsec();
+	s64_t latency;
+
+	beginUpdate(stats);
+
+	/* The first cycle has slept to the common start, so it has a wakeup but no interval yet. */
+	if (stats->track_wakeup)
+	{
+		latency = timestamp - deadline - stats->overhead;
+		updateLatency(&stats->wakeup, (latency > 0) ? latency : 0);
+	}
+
+	updateStatistics(stats, timestamp - stats->last_timestamp);
 
-	min_error = cycle_time;
-	last_statistics_timer.tv_nsec = sched_timer_nsec;
+	stats->last_timestamp = timestamp;
+
+	endUpdate(stats);
+
+	return timestamp;
 }
 
-f32_t getTimestamp(void)
+s64_t getHandoffTimestamp(sched_statistics_t* stats, s64_t stamp)
 {
-	struct timespec current_t;
-	s32_t time_delta;
+	const s64_t timestamp = getClockNsec();
+	const s64_t latency = timestamp - stamp - stats->overhead;
+
+	beginUpdate(stats);
 
-	clock_gettime(CLOCK_MONOTONIC, &current_t);
+	/* The stamp is taken on another core, so the clock must be synchronized across cores. */
+	updateLatency(&stats->handoff, (latency > 0) ? latency : 0);
 
-	time_delta = current_t.tv_nsec - last_statistics_timer.tv_nsec;
-	time_delta = (time_delta >= 0) ? time_delta : (time_delta + 1000000000u);  /* FIXME: Use NSEC_PER_SEC */
-	updateStatistics(time_delta);
+	updateStatistics(stats, timestamp - stats->last_timestamp);
 
-	last_statistics_timer.tv_nsec = current_t.tv_nsec;
+	stats->last_timestamp = timestamp;
 
-	return current_t.tv_sec + (current_t.tv_nsec / (f32_t)1000000000u);
+	endUpdate(stats);
+
+	return timestamp;
 }
 
-void printStatistics(FILE* file)
+u64_t updateOverrun(sched_statistics_t* stats, s64_t now, s64_t release, u8_t skip)
 {
+	u64_t missed;
+
+	if (now <= release)
+		return 0u;
+
+	beginUpdate(stats);
+
+	stats->deadline_misses++;
+
+	/* While catching up, the releases an earlier overrun passed are not counted again. */
+	if (release <= stats->last_missed)
+		release = stats->last_missed + stats->cycle_time;
+
+	missed = (now >= release) ? (u64_t)((now - release) / stats->cycle_time) + 1u : 0u;
+	if (missed > 0u)
+		stats->last_missed = release + ((s64_t)(missed - 1u) * stats->cycle_time);
+
+	stats->missed_periods += missed;
+
+	/* The skipped cycles are not run, so the next interval is measured against them. */
+	if (skip)
+	{
+		stats->skipped_periods += missed;
+		stats->last_timestamp += (s64_t)missed * stats->cycle_time;
+	}
+
+	endUpdate(stats);
+
+	return missed;
+}
+
+void readStatistics(const sched_statistics_t* stats, sched_statistics_t* snapshot)
+{
+	u32_t begin, end;
+
+	do
+	{
+		begin = __atomic_load_n(&stats->sequence, __ATOMIC_ACQUIRE);
+		memcpy(snapshot, stats, sizeof(*snapshot));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		end = __atomic_load_n(&stats->sequence, __ATOMIC_RELAXED);
+	} while (((begin & 1u) != 0u) || (begin != end));
+}
+
+void setStatisticsOverhead(sched_statistics_t* stats, s64_t overhead)
+{
+	stats->overhead = overhead;
+}
+
+void setStatisticsResponse(sched_statistics_t* stats)
+{
+	stats->track_response = 1u;
+}
+
+void setStatisticsHandoff(sched_statistics_t* stats)
+{
+	stats->track_handoff = 1u;
+}
+
+s64_t finishCycle(sched_statistics_t* stats, s64_t release)
+{
+	const s64_t timestamp = getClockNsec();
+	const s64_t response = timestamp - release;
+
+	beginUpdate(stats);
+
+	updateLatency(&stats->response, (response > 0) ? response : 0);
+
+	endUpdate(stats);
+
+	return timestamp;
+}
+
+s64_t timespecToNsec(const struct timespec* time)
+{
+	return ((s64_t)time->tv_sec * (s64_t)NSEC_PER_SEC) + time->tv_nsec;
+}
+
+void nsecToTimespec(s64_t nsec, struct timespec* time)
+{
+	time->tv_sec = nsec / (s64_t)NSEC_PER_SEC;
+	time->tv_nsec = nsec % (s64_t)NSEC_PER_SEC;
+}
+
+f64_t getAverageError(const latency_statistics_t* latency)
+{
+	if (latency->number_of_calls == 0u)
+		return 0.0;
+
+	return (f64_t)latency->sum_error / latency->number_of_calls;
+}
+
+f64_t getStdDeviation(const latency_statistics_t* latency)
+{
+	const f64_t count = (f64_t)latency->number_of_calls;
+	unsigned __int128 squares, square_of_sum, quotient;
+	f64_t variance;
+
+	if (latency->number_of_calls < 2u)
+		return 0.0;
+
+	/* The sum of the squared deviations from the mean is sum(x^2) - sum(x)^2 / n, which is
+	 * subtracted in integers, so that it does not cancel out when the deviation is far below the mean.
+	 * Only the remainder of the division is fractional, and sum(x^2) >= sum(x)^2 / n. */
+	squares = ((unsigned __int128)latency->sum_squares_high << 64) | latency->sum_squares_low;
+	square_of_sum = (unsigned __int128)latency->sum_error * latency->sum_error;
+	quotient = square_of_sum / latency->number_of_calls;
+	variance = ((f64_t)(squares - quotient) -
+	            ((f64_t)(u64_t)(square_of_sum % latency->number_of_calls) / count)) / (count - 1.0);
+
+	return (variance > 0.0) ? sqrt(variance) : 0.0;
+}
+
+s64_t getPercentile(const latency_statistics_t* latency, f64_t percentile)
+{
+	u64_t target, count = 0u;
+	u32_t bucket;
+	f64_t rank;
+
+	if (latency->number_of_calls == 0u)
+		return 0;
+
+	/* The rank of the first sample at or above the percentile (rounded up). */
+	rank = (percentile / 100.0) * latency->number_of_calls;
+	target = (u64_t)rank;
+	if ((target < rank) || (target == 0u))
+		target++;
+
+	for (bucket = 0u; bucket < HISTOGRAM_BUCKETS; bucket++)
+	{
+		count += latency->histogram[bucket];
+		if (count >= target)
+			return (s64_t)((bucket + 1u) * latency->bucket_width);
+	}
+
+	/* The percentile lies in the overflow bucket, so only the max is known. */
+	return latency->max_error;
+}
+
+void printStatistics(const sched_statistics_t* stats, FILE* file)
+{
+	FILE* out = (file == NULL) ? stdout : file;
+	const latency_statistics_t* jitter = &stats->jitter;
+	const latency_statistics_t* wakeup = &stats->wakeup;
+
 	if (file == NULL)
+		fprintf(out, "\n");
+
+	fprintf(out, "# Statistics #\n");
+	fprintf(out, "Average Error: %05.2f us\n", getAverageError(jitter) / NSEC_PER_USEC);
+	fprintf(out, "Std Deviation: %05.2f us\n", getStdDeviation(jitter) / NSEC_PER_USEC);
+	fprintf(out, "Min Error: %05.2f us\n", (f64_t)((jitter->number_of_calls > 0u) ? jitter->min_error : 0) / NSEC_PER_USEC);
+	fprintf(out, "Max Error: %05.2f us\n", (f64_t)jitter->max_error / NSEC_PER_USEC);
+
+	fprintf(out, "\n# Histogram #\n");
+	printPercentiles(out, jitter, "Error");
+
+	if (stats->track_wakeup)
 	{
-		printf("\n# Statistics #\n");
-		printf("Average Error: %05.2f us\n", avg_error / 1000.f);
-		printf("Min Error: %05.2f us\n", min_error / 1000.f);
-		printf("Max Error: %05.2f us\n", max_error / 1000.f);
+		fprintf(out, "\n# Wakeup Latency #\n");
+		fprintf(out, "Average Latency: %05.2f us\n", getAverageError(wakeup) / NSEC_PER_USEC);
+		fprintf(out, "Std Deviation: %05.2f us\n", getStdDeviation(wakeup) / NSEC_PER_USEC);
+		fprintf(out, "Min Latency: %05.2f us\n", (f64_t)((wakeup->number_of_calls > 0u) ? wakeup->min_error : 0) / NSEC_PER_USEC);
+		fprintf(out, "Max Latency: %05.2f us\n", (f64_t)wakeup->max_error / NSEC_PER_USEC);
+		if (stats->overhead != 0)
+			fprintf(out, "Subtracted Overhead: %lld ns\n", stats->overhead);
+		printPercentiles(out, wakeup, "Latency");
 	}
-	else
+
+	if (stats->track_handoff)
 	{
-		fprintf(file, "# Statistics #\n");
-		fprintf(file, "Average Error: %05.2f us\n", avg_error / 1000.f);
-		fprintf(file, "Min Error: %05.2f us\n", min_error / 1000.f);
-		fprintf(file, "Max Error: %05.2f us\n", max_error / 1000.f);
+		fprintf(out, "\n# Handoff Latency #\n");
+		fprintf(out, "Average Latency: %05.2f us\n", getAverageError(&stats->handoff) / NSEC_PER_USEC);
+		fprintf(out, "Std Deviation: %05.2f us\n", getStdDeviation(&stats->handoff) / NSEC_PER_USEC);
+		fprintf(out, "Min Latency: %05.2f us\n",
+		        (f64_t)((stats->handoff.number_of_calls > 0u) ? stats->handoff.min_error : 0) / NSEC_PER_USEC);
+		fprintf(out, "Max Latency: %05.2f us\n", (f64_t)stats->handoff.max_error / NSEC_PER_USEC);
+		printPercentiles(out, &stats->handoff, "Latency");
 	}
+
+	if (stats->track_response)
+	{
+		fprintf(out, "\n# Response Time #\n");
+		fprintf(out, "Average Response: %05.2f us\n", getAverageError(&stats->response) / NSEC_PER_USEC);
+		fprintf(out, "Std Deviation: %05.2f us\n", getStdDeviation(&stats->response) / NSEC_PER_USEC);
+		fprintf(out, "Min Response: %05.2f us\n",
+		        (f64_t)((stats->response.number_of_calls > 0u) ? stats->response.min_error : 0) / NSEC_PER_USEC);
+		fprintf(out, "Max Response: %05.2f us\n", (f64_t)stats->response.max_error / NSEC_PER_USEC);
+		printPercentiles(out, &stats->response, "Response");
+	}
+
+	if (stats->track_response || (stats->deadline_misses > 0u))
+	{
+		fprintf(out, "\n# Overruns #\n");
+		fprintf(out, "Deadline Misses: %llu\n", stats->deadline_misses);
+		fprintf(out, "Missed Periods: %llu\n", stats->missed_periods);
+		fprintf(out, "Skipped Periods: %llu\n", stats->skipped_periods);
+	}
+}
+
+void printStatisticsSummary(const sched_statistics_t* stats, u32_t id, u32_t cpu)
+{
+	printf("T:%2u CPU:%3u ", id, cpu);
+	printLatencySummary(&stats->jitter, "Jitter");
+
+	if (stats->track_wakeup)
+	{
+		printf("T:%2u CPU:%3u ", id, cpu);
+		printLatencySummary(&stats->wakeup, "Wakeup");
+	}
+
+	if (stats->track_handoff)
+	{
+		printf("T:%2u CPU:%3u ", id, cpu);
+		printLatencySummary(&stats->handoff, "Hndoff");
+	}
+
+	if (stats->track_response)
+	{
+		printf("T:%2u CPU:%3u ", id, cpu);
+		printLatencySummary(&stats->response, "Resp");
+	}
+
+	if (stats->track_response || (stats->deadline_misses > 0u))
+		printf("T:%2u CPU:%3u Misses: %llu Missed Periods: %llu Skipped Periods: %llu\n",
+		       id, cpu, stats->deadline_misses, stats->missed_periods, stats->skipped_periods);
 }
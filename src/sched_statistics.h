@@ -15,33 +15,249 @@ extern "C" {
 
 /******************************** Inclusions *********************************/
 
+#include <stdio.h>
+#include <time.h>
+
 #include "data_types.h"
 
+/***************************** Macro Definitions *****************************/
+
+/** The size of a cache line of the target (Cortex-A53 and x86 alike). */
+#define CACHE_LINE_SIZE (64u)
+
+/** The number of nsecs per sec/msec/usec. */
+#define NSEC_PER_SEC (1000000000ul)
+#define NSEC_PER_MSEC (1000000ul)
+#define NSEC_PER_USEC (1000ul)
+
+/** The number of fixed-width buckets of the latency histogram.
+  * Errors beyond the last bucket are counted in an extra overflow bucket.
+  */
+#ifndef HISTOGRAM_BUCKETS
+#define HISTOGRAM_BUCKETS (1000u)
+#endif
+
+/** The default width of a histogram bucket in nsec. */
+#define DEFAULT_BUCKET_WIDTH (1000u)
+
+/***************************** Type Definitions ******************************/
+
+/** The distribution of one latency metric.
+  * All times are kept in nsec, and only converted at report time.
+  * The sums are exact integers (the squares in 128 bits, as two words),
+  * so that the mean and deviation hold for any run length and the RT
+  * path needs no division.
+  */
+typedef struct
+{
+  u64_t number_of_calls;
+
+  s64_t cur_error;
+  u64_t sum_error;
+  u64_t sum_squares_low;   /**< The low word of the sum of the squared errors. */
+  u64_t sum_squares_high;  /**< The high word of the sum of the squared errors. */
+  s64_t min_error;
+  s64_t max_error;
+
+  u64_t bucket_width;   /**< The width of a histogram bucket in nsec. */
+  u64_t bucket_mult;    /**< The reciprocal of the width in 2^63 fixed point, so that bucketing is a multiply. */
+
+  u64_t histogram[HISTOGRAM_BUCKETS + 1u];  /**< The last bucket is the overflow. */
+} latency_statistics_t;
+
+/** The statistics context of a measurement thread.
+  * It is cache line aligned, so that the counters of threads
+  * running on different cores never share a cache line.
+  */
+typedef struct
+{
+  u32_t sequence;  /**< Odd while the thread updates the statistics (seqlock). */
+
+  s64_t last_timestamp;
+
+  u8_t is_first_cycle;
+  u8_t track_wakeup;
+  u8_t track_response;
+  u8_t track_handoff;
+
+  s64_t cycle_time;
+  s64_t overhead;  /**< The measurement overhead subtracted from the wakeup latency. */
+
+  latency_statistics_t jitter;  /**< The deviation of each cycle from the cycle time. */
+  latency_statistics_t wakeup;  /**< The delay of each wakeup after its deadline. */
+  latency_statistics_t response;  /**< The time from each release to the end of its cycle. */
+  latency_statistics_t handoff;   /**< The delay from the stamp of the waking thread to each wakeup. */
+  u64_t deadline_misses;          /**< The cycles that ended after the next release (overruns). */
+  u64_t missed_periods;           /**< The releases that passed during the overruns. */
+  s64_t last_missed;              /**< The last release counted as missed in nsec. */
+  u64_t skipped_periods;          /**< The releases skipped to recover from the overruns. */
+} __attribute__((aligned(CACHE_LINE_SIZE))) sched_statistics_t;
+
 /***************************** Public Functions ******************************/
 
+/**
+  * @brief Reset a latency metric.
+  * @param latency The latency metric to reset.
+  * @param bucket_width The width of a histogram bucket in nsec (rounded up to a power
+  *        of two if the histogram would span more than 2^63 / bucket_width nsec).
+  * @return Void.
+  */
+void initLatency(latency_statistics_t* latency, u64_t bucket_width);
+
+/**
+  * @brief Add an error to a latency metric.
+  * @param latency The latency metric to update.
+  * @param error The (absolute) error in nsec.
+  * @return Void.
+  */
+void updateLatency(latency_statistics_t* latency, s64_t error);
+
 /**
   * @brief Initialize the statistics module.
   * @details This module should be initialized just before the main task
   *          is executed, so that the scheduler's timer is known.
-  * @param cycle The cycle time of the system.
-  * @param sched_timer_nsec The scheduler's timer in nsec.
+  * @param stats The statistics context to initialize.
+  * @param cycle The cycle time of the system in nsec.
+  * @param sched_timer The scheduler's timer in nsec.
+  * @param bucket_width The width of a histogram bucket in nsec.
+  * @param track_wakeup Also track the wakeup latency against the deadline.
   * @return Void.
   */
-void initStatistics(f32_t cycle, s32_t sched_timer_nsec);
+void initStatistics(sched_statistics_t* stats, s64_t cycle, s64_t sched_timer,
+                    u64_t bucket_width, u8_t track_wakeup);
 
 /**
   * @brief Get the current time.
-  * @return The current time.
+  * @details Should be called right after the task wakes up, so that
+  *          the wakeup latency is the delay after the deadline.
+  * @param stats The statistics context to update.
+  * @param deadline The deadline the task has just woken up for in nsec.
+  * @return The current time in nsec.
   */
-f32_t getTimestamp(void);
+s64_t getTimestamp(sched_statistics_t* stats, s64_t deadline);
+
+/**
+  * @brief Track the response time of each cycle, i.e. until finishCycle is called.
+  * @param stats The statistics context to update.
+  * @return Void.
+  */
+void setStatisticsResponse(sched_statistics_t* stats);
+
+/**
+  * @brief Mark the end of the work of a cycle.
+  * @details The response time is measured from the release (the deadline the
+  *          task woke up for), so it includes the wakeup latency.
+  * @param stats The statistics context to update.
+  * @param release The deadline the task woke up for in nsec.
+  * @return The current time in nsec.
+  */
+s64_t finishCycle(sched_statistics_t* stats, s64_t release);
+
+/**
+  * @brief Track the handoff latency of each cycle, i.e. the thread is woken by another thread.
+  * @param stats The statistics context to update.
+  * @return Void.
+  */
+void setStatisticsHandoff(sched_statistics_t* stats);
+
+/**
+  * @brief Get the current time, right after being woken by another thread.
+  * @details Like getTimestamp, but the latency is measured from the stamp
+  *          the waking thread took before the wakeup (on another core).
+  * @param stats The statistics context to update.
+  * @param stamp The stamp of the waking thread in nsec.
+  * @return The current time in nsec.
+  */
+s64_t getHandoffTimestamp(sched_statistics_t* stats, s64_t stamp);
+
+/**
+  * @brief Account for a cycle that ended after the next release (an overrun).
+  * @details Under the skip policy the skipped releases are taken out of the
+  *          jitter of the next cycle, under catch-up the delay shows in it.
+  * @param stats The statistics context to update.
+  * @param now The time the cycle ended in nsec.
+  * @param release The next release of the task in nsec.
+  * @param skip Whether the releases that passed are skipped (or caught up with).
+  * @return The releases that passed (not counted before), 0 if the cycle ended in time.
+  */
+u64_t updateOverrun(sched_statistics_t* stats, s64_t now, s64_t release, u8_t skip);
+
+/**
+  * @brief Read a consistent snapshot of the statistics of another thread.
+  * @details The measurement thread never waits for the reader: the reader
+  *          retries its copy while the statistics are being updated.
+  * @param stats The statistics context to read.
+  * @param snapshot The copy to fill.
+  * @return Void.
+  */
+void readStatistics(const sched_statistics_t* stats, sched_statistics_t* snapshot);
+
+/**
+  * @brief Set the measurement overhead subtracted from the wakeup latency.
+  * @details The jitter is the difference of two timestamps, so a constant
+  *          overhead cancels out of it and is not subtracted.
+  * @param stats The statistics context to update.
+  * @param overhead The overhead in nsec.
+  * @return Void.
+  */
+void setStatisticsOverhead(sched_statistics_t* stats, s64_t overhead);
+
+/**
+  * @brief Convert a time to nsec.
+  * @param time The time to convert.
+  * @return The time in nsec.
+  */
+s64_t timespecToNsec(const struct timespec* time);
+
+/**
+  * @brief Convert a time in nsec to a timespec.
+  * @param nsec The time in nsec.
+  * @param time The converted time.
+  * @return Void.
+  */
+void nsecToTimespec(s64_t nsec, struct timespec* time);
+
+/**
+  * @brief Get the average error of a latency metric.
+  * @param latency The latency metric to read.
+  * @return The average error in nsec.
+  */
+f64_t getAverageError(const latency_statistics_t* latency);
+
+/**
+  * @brief Get the standard deviation of the errors of a latency metric.
+  * @param latency The latency metric to read.
+  * @return The (sample) standard deviation in nsec.
+  */
+f64_t getStdDeviation(const latency_statistics_t* latency);
+
+/**
+  * @brief Get a percentile of the errors of a latency metric from its histogram.
+  * @param latency The latency metric to read.
+  * @param percentile The percentile to get (e.g. 99.9).
+  * @return The upper bound of the bucket the percentile lies in (in nsec),
+  *         or the max error if it lies in the overflow bucket.
+  */
+s64_t getPercentile(const latency_statistics_t* latency, f64_t percentile);
 
 /**
   * @brief Print the scheduler's statistics to file/console.
+  * @param stats The statistics context to print.
   * @param file The file to print the statistics to. Print to console if NULL.
   * @warning If the system's cycle time is too low, the buffer might overflow!
   * @return Void.
   */
-void printStatistics(FILE* file);
+void printStatistics(const sched_statistics_t* stats, FILE* file);
+
+/**
+  * @brief Print the statistics of a measurement thread as a single line
+  *        per metric, so that the statistics of all threads are shown side by side.
+  * @param stats The statistics context to print.
+  * @param id The index of the measurement thread.
+  * @param cpu The CPU the measurement thread is pinned to.
+  * @return Void.
+  */
+void printStatisticsSummary(const sched_statistics_t* stats, u32_t id, u32_t cpu);
 
 /*****************************************************************************/
 
@@ -0,0 +1,467 @@
+/**
+  * @file sched_summary.c
+  * @brief Implements the machine-readable summary of a run (JSON and CSV),
+  *        so that results can be compared without parsing the text output.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+/******************************** Inclusions *********************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <sys/utsname.h>
+
+#include "sched_summary.h"
+#include "sched_preflight.h"
+#include "sched_clock.h"
+#include "sched_load.h"
+
+/***************************** Macro Definitions *****************************/
+
+/** The maximum length of a line read from a system file. */
+#define SUMMARY_LINE_SIZE (4096u)
+
+/***************************** Static Variables ******************************/
+
+/** The percentiles of each metric, with their JSON/CSV names. */
+static const f64_t summary_percentiles[] = { 50.0, 90.0, 99.0, 99.9, 99.99 };
+static const char* const summary_percentile_names[] = { "p50", "p90", "p99", "p99.9", "p99.99" };
+
+/** The names of the sample, wait and phase modes, indexed by their value. */
+static const char* const sample_mode_names[] = { "buffer", "none", "stream" };
+static const char* const wait_mode_names[] = { "sleep", "spin", "hybrid" };
+static const char* const phase_mode_names[] = { "align", "stagger" };
+
+/************************ Static Function Prototypes *************************/
+
+/**
+  * @brief Write a JSON string, escaping it as needed.
+  * @param file The file to write to.
+  * @param string The string to write.
+  * @return Void.
+  */
+static void writeJsonString(FILE* file, const char* string);
+
+/**
+  * @brief Read the first line of a file, or the value of the first line
+  *        that starts with a key (as in /proc/cpuinfo).
+  * @param path The file to read.
+  * @param key The key of the line (NULL for the first line).
+  * @param line The buffer to read the line (or value) to.
+  * @param size The size of the buffer.
+  * @return TRUE on success, FALSE if the file or key was not found.
+  */
+static u8_t readSystemLine(const char* path, const char* key, char* line, size_t size);
+
+/**
+  * @brief Write a latency metric as a JSON object.
+  * @param file The file to write to.
+  * @param latency The latency metric to write.
+  * @param indent The indentation of the object.
+  * @return Void.
+  */
+static void writeLatencyJson(FILE* file, const latency_statistics_t* latency, const char* indent);
+
+/**
+  * @brief Write the kernel and CPU of the system as a JSON object.
+  * @param file The file to write to.
+  * @return Void.
+  */
+static void writeSystemJson(FILE* file);
+
+/**
+  * @brief Write the interference counters of a thread as a JSON object.
+  * @param file The file to write to.
+  * @param interference The interference of the thread.
+  * @return Void.
+  */
+static void writeInterferenceJson(FILE* file, const interference_t* interference);
+
+/**
+  * @brief Write the counters of a latency band (or of the whole run) as JSON members.
+  * @param file The file to write to.
+  * @param counters The counters to write.
+  * @param has_perf Whether the perf_event counters were read.
+  * @return Void.
+  */
+static void writeCountersJson(FILE* file, const interference_counters_t* counters, u8_t has_perf);
+
+/**
+  * @brief Write a latency metric as a CSV row.
+  * @param file The file to write to.
+  * @param thread The thread the metric belongs to.
+  * @param latency The latency metric to write.
+  * @param name The name of the metric.
+  * @return Void.
+  */
+static void writeLatencyCsv(FILE* file, const summary_thread_t* thread,
+                            const latency_statistics_t* latency, const char* name);
+
+/***************************** Static Functions ******************************/
+
+void writeJsonString(FILE* file, const char* string)
+{
+  const unsigned char* cur;
+
+  fputc('"', file);
+
+  for (cur = (const unsigned char*)string; *cur != '\0'; cur++)
+  {
+    if ((*cur == '"') || (*cur == '\\'))
+      fprintf(file, "\\%c", *cur);
+    else if (*cur < 0x20u)
+      fprintf(file, "\\u%04x", *cur);
+    else
+      fputc(*cur, file);
+  }
+
+  fputc('"', file);
+}
+
+u8_t readSystemLine(const char* path, const char* key, char* line, size_t size)
+{
+  FILE* file = fopen(path, "r");
+  u8_t found = FALSE;
+  char* value;
+
+  if (file == NULL)
+    return FALSE;
+
+  while (!found && (fgets(line, (int)size, file) != NULL))
+  {
+    value = line;
+
+    if (key != NULL)
+    {
+      if ((strncmp(line, key, strlen(key)) != 0) || ((value = strchr(line, ':')) == NULL))
+        continue;
+
+      for (value++; *value == ' '; value++)
+        ;
+    }
+
+    memmove(line, value, strlen(value) + 1u);
+    line[strcspn(line, "\n")] = '\0';
+    found = TRUE;
+  }
+
+  fclose(file);
+
+  return found;
+}
+
+void writeLatencyJson(FILE* file, const latency_statistics_t* latency, const char* indent)
+{
+  const char* separator = "";
+  u32_t i;
+
+  fprintf(file, "{\n");
+  fprintf(file, "%s  \"count\": %llu,\n", indent, latency->number_of_calls);
+  fprintf(file, "%s  \"avg_ns\": %.1f,\n", indent, getAverageError(latency));
+  fprintf(file, "%s  \"stddev_ns\": %.1f,\n", indent, getStdDeviation(latency));
+  fprintf(file, "%s  \"min_ns\": %lld,\n", indent, (latency->number_of_calls > 0u) ? latency->min_error : 0);
+  fprintf(file, "%s  \"max_ns\": %lld,\n", indent, latency->max_error);
+
+  fprintf(file, "%s  \"percentiles_ns\": {", indent);
+  for (i = 0u; i < sizeof(summary_percentiles) / sizeof(summary_percentiles[0]); i++)
+    fprintf(file, "%s \"%s\": %lld", (i > 0u) ? "," : "", summary_percentile_names[i],
+            getPercentile(latency, summary_percentiles[i]));
+  fprintf(file, " },\n");
+
+  /* Only the non-empty buckets, as [index, count] pairs (the last index is the overflow). */
+  fprintf(file, "%s  \"bucket_width_ns\": %llu,\n", indent, latency->bucket_width);
+  fprintf(file, "%s  \"overflow\": %llu,\n", indent, latency->histogram[HISTOGRAM_BUCKETS]);
+  fprintf(file, "%s  \"histogram\": [", indent);
+  for (i = 0u; i <= HISTOGRAM_BUCKETS; i++)
+  {
+    if (latency->histogram[i] == 0u)
+      continue;
+
+    fprintf(file, "%s[%u, %llu]", separator, i, latency->histogram[i]);
+    separator = ", ";
+  }
+  fprintf(file, "]\n");
+
+  fprintf(file, "%s}", indent);
+}
+
+void writeSystemJson(FILE* file)
+{
+  const preflight_t* preflight = getPreflight();
+  char line[SUMMARY_LINE_SIZE];
+  struct utsname name;
+
+  fprintf(file, "{\n");
+
+  if (uname(&name) == 0)
+  {
+    fprintf(file, "    \"hostname\": ");
+    writeJsonString(file, name.nodename);
+    fprintf(file, ",\n    \"kernel\": ");
+    writeJsonString(file, name.release);
+    fprintf(file, ",\n    \"kernel_version\": ");
+    writeJsonString(file, name.version);
+    fprintf(file, ",\n    \"machine\": ");
+    writeJsonString(file, name.machine);
+    fprintf(file, ",\n");
+  }
+
+  /* x86 reports a model name, ARM only its implementer and part. */
+  if (readSystemLine("/proc/cpuinfo", "model name", line, sizeof(line)) ||
+      readSystemLine("/proc/cpuinfo", "Model", line, sizeof(line)) ||
+      readSystemLine("/proc/cpuinfo", "CPU part", line, sizeof(line)))
+  {
+    fprintf(file, "    \"cpu_model\": ");
+    writeJsonString(file, line);
+    fprintf(file, ",\n");
+  }
+
+  if (readSystemLine("/proc/cmdline", NULL, line, sizeof(line)))
+  {
+    fprintf(file, "    \"cmdline\": ");
+    writeJsonString(file, line);
+    fprintf(file, ",\n");
+  }
+
+  fprintf(file, "    \"preempt_rt\": %s,\n",
+          (readSystemLine("/sys/kernel/realtime", NULL, line, sizeof(line)) && (line[0] == '1')) ? "true" : "false");
+  fprintf(file, "    \"online_cpus\": %ld", sysconf(_SC_NPROCESSORS_ONLN));
+
+  /* The settings of the measured CPUs, so that runs of different systems compare. */
+  if (preflight != NULL)
+  {
+    fprintf(file, ",\n    \"preflight\": {\n");
+    fprintf(file, "      \"governor\": ");
+    writeJsonString(file, preflight->governor);
+    fprintf(file, ",\n      \"slow_governors\": %u,\n", preflight->slow_governors);
+    fprintf(file, "      \"idle_latency_us\": %llu,\n", preflight->idle_latency);
+    fprintf(file, "      \"not_isolated\": %u,\n", preflight->not_isolated);
+    fprintf(file, "      \"not_nohz_full\": %u,\n", preflight->not_nohz_full);
+    fprintf(file, "      \"rt_runtime_us\": %lld,\n", preflight->rt_runtime);
+    fprintf(file, "      \"shared_irqs\": %u,\n", preflight->shared_irqs);
+    fprintf(file, "      \"warnings\": %u,\n", preflight->warnings);
+    fprintf(file, "      \"dma_latency_held\": %s,\n", preflight->dma_latency_held ? "true" : "false");
+    fprintf(file, "      \"moved_irqs\": %u\n", preflight->moved_irqs);
+    fprintf(file, "    }");
+  }
+  fprintf(file, "\n");
+
+  fprintf(file, "  }");
+}
+
+void writeCountersJson(FILE* file, const interference_counters_t* counters, u8_t has_perf)
+{
+  u32_t i;
+
+  fprintf(file, "\"voluntary_csw\": %llu, \"involuntary_csw\": %llu", counters->voluntary, counters->involuntary);
+
+  for (i = 0u; has_perf && (i < PERF_COUNTERS); i++)
+    fprintf(file, ", \"%s\": %llu", getPerfCounterName((perf_counter_t)i), counters->perf[i]);
+}
+
+void writeInterferenceJson(FILE* file, const interference_t* interference)
+{
+  u32_t i;
+
+  fprintf(file, "{\n");
+  fprintf(file, "        \"irqs\": %llu,\n", interference->irqs_end - interference->irqs_start);
+  if (interference->has_smis)
+    fprintf(file, "        \"smis\": %llu,\n", (interference->smis_end - interference->smis_start) & U32_MAX);
+  else
+    fprintf(file, "        \"smis\": null,\n");
+
+  fprintf(file, "        ");
+  writeCountersJson(file, &interference->total, interference->has_perf);
+  fprintf(file, ",\n");
+
+  /* The counters of the cycles of each latency band, to be laid next to the histogram. */
+  fprintf(file, "        \"bands\": [");
+  for (i = 0u; i < INTERFERENCE_BANDS; i++)
+  {
+    fprintf(file, "%s\n          { \"latency\": \"%s\", \"cycles\": %llu, ", (i > 0u) ? "," : "",
+            getInterferenceBandName(i), interference->band_cycles[i]);
+    writeCountersJson(file, &interference->bands[i], interference->has_perf);
+    fprintf(file, " }");
+  }
+  fprintf(file, "\n        ]\n");
+
+  fprintf(file, "      }");
+}
+
+void writeLatencyCsv(FILE* file, const summary_thread_t* thread,
+                     const latency_statistics_t* latency, const char* name)
+{
+  u32_t i;
+
+  fprintf(file, "%u,%u,%s,%llu,%.1f,%.1f,%lld,%lld", thread->id, thread->cpu, name,
+          latency->number_of_calls, getAverageError(latency), getStdDeviation(latency),
+          (latency->number_of_calls > 0u) ? latency->min_error : 0, latency->max_error);
+
+  for (i = 0u; i < sizeof(summary_percentiles) / sizeof(summary_percentiles[0]); i++)
+    fprintf(file, ",%lld", getPercentile(latency, summary_percentiles[i]));
+
+  fprintf(file, ",%llu\n", latency->histogram[HISTOGRAM_BUCKETS]);
+}
+
+/***************************** Public Functions ******************************/
+
+void writeSummaryJson(FILE* file, const sched_config_t* config,
+                      const summary_thread_t* threads, u32_t num_threads,
+                      const overhead_statistics_t* overheads, u32_t num_overheads)
+{
+  const char* separator = "";
+  u32_t i;
+
+  fprintf(file, "{\n");
+  fprintf(file, "  \"version\": %u,\n", SUMMARY_VERSION);
+
+  fprintf(file, "  \"config\": {\n");
+  fprintf(file, "    \"cycle_time_ns\": %llu,\n", config->cycle_time);
+  fprintf(file, "    \"cycles\": %llu,\n", config->cycle_num);
+  fprintf(file, "    \"duration_ns\": %llu,\n", config->duration);
+  fprintf(file, "    \"threads\": %u,\n", config->num_threads);
+  fprintf(file, "    \"policy\": \"%s\",\n", getSchedPolicyName(config->policy));
+  if (config->policy == SCHED_POLICY_DEADLINE)
+  {
+    fprintf(file, "    \"dl_runtime_ns\": %llu,\n", config->dl_runtime);
+    fprintf(file, "    \"dl_deadline_ns\": %llu,\n", config->dl_deadline);
+  }
+  fprintf(file, "    \"clock\": \"%s\",\n", getClockName());
+  fprintf(file, "    \"counter_frequency_hz\": %llu,\n", getCounterFrequency());
+  fprintf(file, "    \"wait_mode\": \"%s\",\n", wait_mode_names[config->wait_mode]);
+  fprintf(file, "    \"spin_margin_ns\": %llu,\n", config->spin_margin);
+  fprintf(file, "    \"phase\": \"%s\",\n", phase_mode_names[config->phase_mode]);
+  fprintf(file, "    \"sample_mode\": \"%s\",\n", sample_mode_names[config->sample_mode]);
+  fprintf(file, "    \"track_wakeup\": %s,\n", config->track_wakeup ? "true" : "false");
+  fprintf(file, "    \"subtract_overhead\": %s,\n", config->subtract_overhead ? "true" : "false");
+  if (config->pingpong)
+    fprintf(file, "    \"pingpong\": \"%s\",\n", getPingPongName(config->pingpong_mode));
+  fprintf(file, "    \"overrun\": \"%s\",\n", (config->overrun_policy == OVERRUN_POLICY_SKIP) ? "skip" : "catchup");
+  fprintf(file, "    \"break_threshold_ns\": %llu,\n", config->break_threshold);
+  fprintf(file, "    \"interference_threshold_ns\": %llu,\n", config->interference_threshold);
+  fprintf(file, "    \"loads\": [");
+  for (i = 0u; i < config->num_loads; i++)
+    fprintf(file, "%s{ \"type\": \"%s\", \"cpu\": %u }", (i > 0u) ? ", " : "",
+            getLoadName(config->loads[i].type), config->loads[i].cpu);
+  fprintf(file, "]\n");
+  fprintf(file, "  },\n");
+
+  fprintf(file, "  \"system\": ");
+  writeSystemJson(file);
+  fprintf(file, ",\n");
+
+  /* A clock that is not supported on this CPU has no calibration. */
+  fprintf(file, "  \"overhead\": [");
+  for (i = 0u; (overheads != NULL) && (i < num_overheads); i++)
+  {
+    if (overheads[i].clock_read.number_of_calls == 0u)
+      continue;
+
+    fprintf(file, "%s\n    {\n", separator);
+    fprintf(file, "      \"clock\": \"%s\",\n",
+            (overheads[i].source == CLOCK_SOURCE_COUNTER) ? "counter" : "monotonic");
+    fprintf(file, "      \"median_ns\": %lld,\n", overheads[i].median);
+    fprintf(file, "      \"clock_read\": ");
+    writeLatencyJson(file, &overheads[i].clock_read, "      ");
+    fprintf(file, ",\n      \"sample_path\": ");
+    writeLatencyJson(file, &overheads[i].sample_path, "      ");
+    fprintf(file, "\n    }");
+    separator = ",";
+  }
+  fprintf(file, "%s],\n", (separator[0] != '\0') ? "\n  " : "");
+
+  fprintf(file, "  \"threads\": [");
+  for (i = 0u; i < num_threads; i++)
+  {
+    fprintf(file, "%s\n    {\n", (i > 0u) ? "," : "");
+    fprintf(file, "      \"id\": %u,\n", threads[i].id);
+    fprintf(file, "      \"cpu\": %u,\n", threads[i].cpu);
+    fprintf(file, "      \"priority\": %u,\n", threads[i].priority);
+    fprintf(file, "      \"cycles\": %llu,\n", threads[i].cycles);
+    fprintf(file, "      \"cycle_time_ns\": %lld,\n", threads[i].stats->cycle_time);
+    fprintf(file, "      \"work_ns\": %llu,\n", threads[i].work);
+    fprintf(file, "      \"working_set_bytes\": %llu,\n", threads[i].working_set);
+    fprintf(file, "      \"jitter\": ");
+    writeLatencyJson(file, &threads[i].stats->jitter, "      ");
+
+    if (threads[i].stats->track_wakeup)
+    {
+      fprintf(file, ",\n      \"wakeup\": ");
+      writeLatencyJson(file, &threads[i].stats->wakeup, "      ");
+    }
+
+    if (threads[i].stats->track_handoff)
+    {
+      fprintf(file, ",\n      \"handoff\": ");
+      writeLatencyJson(file, &threads[i].stats->handoff, "      ");
+    }
+
+    if (threads[i].stats->track_response)
+    {
+      fprintf(file, ",\n      \"response\": ");
+      writeLatencyJson(file, &threads[i].stats->response, "      ");
+    }
+
+    fprintf(file, ",\n      \"deadline_misses\": %llu", threads[i].stats->deadline_misses);
+    fprintf(file, ",\n      \"missed_periods\": %llu", threads[i].stats->missed_periods);
+    fprintf(file, ",\n      \"skipped_periods\": %llu", threads[i].stats->skipped_periods);
+
+    if (threads[i].interference != NULL)
+    {
+      fprintf(file, ",\n      \"interference\": ");
+      writeInterferenceJson(file, threads[i].interference);
+    }
+
+    fprintf(file, "\n    }");
+  }
+  fprintf(file, "%s]\n", (num_threads > 0u) ? "\n  " : "");
+
+  fprintf(file, "}\n");
+}
+
+void writeSummaryCsv(FILE* file, const summary_thread_t* threads, u32_t num_threads)
+{
+  u32_t i;
+
+  fprintf(file, "thread,cpu,metric,count,avg_ns,stddev_ns,min_ns,max_ns");
+  for (i = 0u; i < sizeof(summary_percentiles) / sizeof(summary_percentiles[0]); i++)
+    fprintf(file, ",%s_ns", summary_percentile_names[i]);
+  fprintf(file, ",overflow\n");
+
+  for (i = 0u; i < num_threads; i++)
+  {
+    writeLatencyCsv(file, &threads[i], &threads[i].stats->jitter, "jitter");
+
+    if (threads[i].stats->track_wakeup)
+      writeLatencyCsv(file, &threads[i], &threads[i].stats->wakeup, "wakeup");
+
+    if (threads[i].stats->track_handoff)
+      writeLatencyCsv(file, &threads[i], &threads[i].stats->handoff, "handoff");
+
+    if (threads[i].stats->track_response)
+      writeLatencyCsv(file, &threads[i], &threads[i].stats->response, "response");
+  }
+}
+
+void writeSnapshotJson(FILE* file, const char* node, const summary_thread_t* thread, u32_t num_threads,
+                       const char* metric, const latency_statistics_t* latency, u64_t sequence, u8_t done)
+{
+  fprintf(file, "{\n");
+  fprintf(file, "  \"version\": %u,\n", SUMMARY_VERSION);
+  fprintf(file, "  \"node\": ");
+  writeJsonString(file, node);
+  fprintf(file, ",\n  \"sequence\": %llu,\n", sequence);
+  fprintf(file, "  \"done\": %s,\n", done ? "true" : "false");
+  fprintf(file, "  \"threads\": %u,\n", num_threads);
+  fprintf(file, "  \"thread\": %u,\n", thread->id);
+  fprintf(file, "  \"cpu\": %u,\n", thread->cpu);
+  fprintf(file, "  \"priority\": %u,\n", thread->priority);
+  fprintf(file, "  \"metric\": \"%s\",\n", metric);
+  fprintf(file, "  \"latency\": ");
+  writeLatencyJson(file, latency, "  ");
+  fprintf(file, "\n}\n");
+}
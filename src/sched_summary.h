@@ -0,0 +1,95 @@
+/**
+  * @file sched_summary.h
+  * @brief Contains the declarations of functions defined in sched_summary.c.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+#ifndef SCHED_SUMMARY_H
+#define SCHED_SUMMARY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************** Inclusions *********************************/
+
+#include <stdio.h>
+
+#include "data_types.h"
+#include "sched_config.h"
+#include "sched_statistics.h"
+#include "sched_calibration.h"
+#include "sched_interference.h"
+
+/***************************** Macro Definitions *****************************/
+
+/** The version of the JSON summary, bumped on incompatible changes. */
+#define SUMMARY_VERSION (1u)
+
+/***************************** Type Definitions ******************************/
+
+/** The results of a measurement thread, as given to the summary. */
+typedef struct
+{
+  u32_t id;                          /**< The index of the thread. */
+  u32_t cpu;                         /**< The CPU the thread is pinned to. */
+  u32_t priority;                    /**< The priority of the thread. */
+  u64_t cycles;                      /**< The cycles the thread has run for. */
+  u64_t work;                        /**< The busy work of each cycle in nsec. */
+  u64_t working_set;                 /**< The memory touched each cycle in bytes. */
+  const sched_statistics_t* stats;   /**< The statistics of the thread. */
+  const interference_t* interference; /**< The interference of the thread (NULL if not counted). */
+} summary_thread_t;
+
+/***************************** Public Functions ******************************/
+
+/**
+  * @brief Write the summary of a run as a single JSON object.
+  * @details Holds the configuration, the system, the overhead calibration
+  *          (of every calibrated clock) and, for every thread, the statistics,
+  *          percentiles and non-empty histogram buckets of each metric.
+  * @param file The file to write to.
+  * @param config The configuration of the run.
+  * @param threads The results of each thread.
+  * @param num_threads The number of threads.
+  * @param overheads The overhead of each clock (NULL if not calibrated).
+  * @param num_overheads The number of clocks.
+  * @return Void.
+  */
+void writeSummaryJson(FILE* file, const sched_config_t* config,
+                      const summary_thread_t* threads, u32_t num_threads,
+                      const overhead_statistics_t* overheads, u32_t num_overheads);
+
+/**
+  * @brief Write the summary of a run as CSV, one row per thread and metric.
+  * @param file The file to write to.
+  * @param threads The results of each thread.
+  * @param num_threads The number of threads.
+  * @return Void.
+  */
+void writeSummaryCsv(FILE* file, const summary_thread_t* threads, u32_t num_threads);
+
+/**
+  * @brief Write a metric of a thread as a single JSON snapshot, as sent to a collector.
+  * @param file The file to write to.
+  * @param node The name of the node the thread runs on.
+  * @param thread The results of the thread.
+  * @param num_threads The number of threads of the run.
+  * @param metric The name of the metric (e.g. "wakeup").
+  * @param latency The latency metric to write.
+  * @param sequence The number of the report.
+  * @param done Whether these are the final results of the thread.
+  * @return Void.
+  */
+void writeSnapshotJson(FILE* file, const char* node, const summary_thread_t* thread, u32_t num_threads,
+                       const char* metric, const latency_statistics_t* latency, u64_t sequence, u8_t done);
+
+/*****************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* SCHED_SUMMARY_H */
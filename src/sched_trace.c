@@ -0,0 +1,348 @@
+/**
+  * @file sched_trace.c
+  * @brief Implements the latency breach, which stops ftrace on the first
+  *        outlier and records the context it happened in.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+/******************************** Inclusions *********************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "sched_trace.h"
+#include "sched_statistics.h"
+#include "sched_clock.h"
+
+/***************************** Macro Definitions *****************************/
+
+/** The maximum size of a snapshot of the interrupts. */
+#define TRACE_SNAPSHOT_SIZE (64u * 1024u)
+
+/** The maximum size of a trace marker. */
+#define TRACE_MARKER_SIZE (128u)
+
+/** The file the interrupt counters are read from. */
+#define INTERRUPTS_FILE "/proc/interrupts"
+
+/***************************** Type Definitions ******************************/
+
+/** A snapshot of the interrupt counters. */
+typedef struct
+{
+  char data[TRACE_SNAPSHOT_SIZE];  /**< The contents of the interrupts file. */
+  u64_t size;                      /**< The size of the contents. */
+  s64_t time;                      /**< The time the snapshot was taken in nsec. */
+} trace_snapshot_t;
+
+/** The context of the first breach. */
+typedef struct
+{
+  u32_t id;           /**< The index of the thread. */
+  u32_t cpu;          /**< The CPU of the thread. */
+  u64_t cycle;        /**< The index of the cycle. */
+  s64_t latency;      /**< The latency that exceeded the threshold in nsec. */
+  s64_t timestamp;    /**< The time of the cycle in nsec. */
+} trace_breach_t;
+
+/***************************** Static Variables ******************************/
+
+/** The directories tracefs may be mounted at. */
+static const char* const tracing_dirs[] = { "/sys/kernel/tracing", "/sys/kernel/debug/tracing" };
+
+/** The open ftrace and interrupts files (-1 if not available). */
+static int marker_fd = -1;
+static int tracing_on_fd = -1;
+static int interrupts_fd = -1;
+
+/** The latency that breaks the trace in nsec. */
+static u64_t trace_threshold;
+
+/** Whether the trace has been broken (set once by the first breach). */
+static u8_t trace_broken;
+
+/** The context of the first breach. */
+static trace_breach_t breach;
+
+/** The last two snapshots before the breach, and the one after it (too large for the stack). */
+static trace_snapshot_t snapshots[2];
+static trace_snapshot_t breach_snapshot;
+
+/** The index of the last complete snapshot before the breach. */
+static u32_t recent_snapshot;
+
+/** Whether the snapshot of the breach has been taken. */
+static u8_t breach_collected;
+
+/************************ Static Function Prototypes *************************/
+
+/**
+  * @brief Open a file of tracefs for writing.
+  * @param name The name of the file.
+  * @return The file descriptor, -1 if tracefs is not available.
+  */
+static int openTraceFile(const char* name);
+
+/**
+  * @brief Read the interrupt counters into a snapshot.
+  * @param snapshot The snapshot to fill.
+  * @return Void.
+  */
+static void takeSnapshot(trace_snapshot_t* snapshot);
+
+/**
+  * @brief Parse a line of the interrupts file.
+  * @param line The start of the line.
+  * @param end The end of the line.
+  * @param label The length of the label of the line (0 if it has none).
+  * @param description The description after the counters.
+  * @return The sum of the counters of every CPU.
+  */
+static u64_t parseInterrupts(const char* line, const char* end, u32_t* label, const char** description);
+
+/**
+  * @brief Get the sum of the counters of an interrupt in a snapshot.
+  * @param snapshot The snapshot to search.
+  * @param name The label of the interrupt.
+  * @param length The length of the label.
+  * @return The sum of the counters, 0 if the interrupt is not in the snapshot.
+  */
+static u64_t findInterrupts(const trace_snapshot_t* snapshot, const char* name, u32_t length);
+
+/***************************** Static Functions ******************************/
+
+int openTraceFile(const char* name)
+{
+  char path[256];
+  u32_t i;
+  int fd;
+
+  for (i = 0u; i < sizeof(tracing_dirs) / sizeof(tracing_dirs[0]); i++)
+  {
+    snprintf(path, sizeof(path), "%s/%s", tracing_dirs[i], name);
+
+    if ((fd = open(path, O_WRONLY)) >= 0)
+      return fd;
+  }
+
+  return -1;
+}
+
+void takeSnapshot(trace_snapshot_t* snapshot)
+{
+  ssize_t bytes;
+
+  snapshot->size = 0u;
+  snapshot->time = getClockNsec();
+
+  if (interrupts_fd < 0)
+    return;
+
+  while ((snapshot->size < sizeof(snapshot->data)) &&
+         ((bytes = pread(interrupts_fd, snapshot->data + snapshot->size,
+                         sizeof(snapshot->data) - snapshot->size, (off_t)snapshot->size)) > 0))
+    snapshot->size += (u64_t)bytes;
+}
+
+u64_t parseInterrupts(const char* line, const char* end, u32_t* label, const char** description)
+{
+  const char* cur = line;
+  u64_t sum = 0u, value;
+
+  *label = 0u;
+  *description = end;
+
+  /* The header line (and any line without a label) has no counters. */
+  while ((cur < end) && (*cur == ' '))
+    cur++;
+
+  line = cur;
+  while ((cur < end) && (*cur != ':') && (*cur != ' '))
+    cur++;
+
+  if ((cur >= end) || (*cur != ':'))
+    return 0u;
+
+  *label = (u32_t)(cur - line);
+  cur++;
+
+  /* One counter per CPU, followed by the description of the interrupt. */
+  for (;;)
+  {
+    while ((cur < end) && (*cur == ' '))
+      cur++;
+
+    if ((cur >= end) || (*cur < '0') || (*cur > '9'))
+      break;
+
+    for (value = 0u; (cur < end) && (*cur >= '0') && (*cur <= '9'); cur++)
+      value = (value * 10u) + (u64_t)(*cur - '0');
+
+    sum += value;
+  }
+
+  *description = cur;
+
+  return sum;
+}
+
+u64_t findInterrupts(const trace_snapshot_t* snapshot, const char* name, u32_t length)
+{
+  const char* cur = snapshot->data;
+  const char* data_end = snapshot->data + snapshot->size;
+  const char* end;
+  const char* description;
+  u64_t sum;
+  u32_t label;
+
+  for (; cur < data_end; cur = end + 1)
+  {
+    if ((end = memchr(cur, '\n', (size_t)(data_end - cur))) == NULL)
+      end = data_end;
+
+    sum = parseInterrupts(cur, end, &label, &description);
+
+    while (*cur == ' ')
+      cur++;
+
+    if ((label == length) && (memcmp(cur, name, length) == 0))
+      return sum;
+  }
+
+  return 0u;
+}
+
+/***************************** Public Functions ******************************/
+
+u8_t initTrace(u64_t threshold)
+{
+  trace_threshold = threshold;
+  trace_broken = FALSE;
+  breach_collected = FALSE;
+  recent_snapshot = 0u;
+
+  marker_fd = openTraceFile("trace_marker");
+  tracing_on_fd = openTraceFile("tracing_on");
+  interrupts_fd = open(INTERRUPTS_FILE, O_RDONLY);
+
+  takeSnapshot(&snapshots[recent_snapshot]);
+
+  return (tracing_on_fd >= 0) ? TRUE : FALSE;
+}
+
+void sampleTrace(void)
+{
+  const u32_t next = recent_snapshot ^ 1u;
+
+  if (__atomic_load_n(&trace_broken, __ATOMIC_ACQUIRE))
+    return;
+
+  takeSnapshot(&snapshots[next]);
+
+  /* A snapshot that overlapped the breach holds some of its interrupts, so the last one is kept. */
+  if (!__atomic_load_n(&trace_broken, __ATOMIC_ACQUIRE))
+    recent_snapshot = next;
+}
+
+void breakTrace(u32_t id, u32_t cpu, u64_t cycle, s64_t latency, s64_t timestamp)
+{
+  char marker[TRACE_MARKER_SIZE];
+  int length;
+
+  /* Only the first breach stops the trace, the later ones are its aftermath. */
+  if (__atomic_exchange_n(&trace_broken, TRUE, __ATOMIC_ACQ_REL))
+    return;
+
+  if (marker_fd >= 0)
+  {
+    length = snprintf(marker, sizeof(marker), "rt_test: T:%u CPU:%u cycle %llu latency %lld ns > %llu ns\n",
+                      id, cpu, cycle, latency, trace_threshold);
+    (void)write(marker_fd, marker, (size_t)length);
+  }
+
+  if (tracing_on_fd >= 0)
+    (void)write(tracing_on_fd, "0", 1u);
+
+  breach.id = id;
+  breach.cpu = cpu;
+  breach.cycle = cycle;
+  breach.latency = latency;
+  breach.timestamp = timestamp;
+}
+
+void collectTrace(void)
+{
+  if (__atomic_load_n(&trace_broken, __ATOMIC_ACQUIRE) && !breach_collected)
+  {
+    takeSnapshot(&breach_snapshot);
+    breach_collected = TRUE;
+  }
+}
+
+void printTrace(FILE* file)
+{
+  FILE* out = (file == NULL) ? stdout : file;
+  const trace_snapshot_t* recent = &snapshots[recent_snapshot];
+  const char* cur = breach_snapshot.data;
+  const char* data_end = breach_snapshot.data + breach_snapshot.size;
+  const char* end;
+  const char* description;
+  u64_t sum, start;
+  u32_t label;
+
+  if (!__atomic_load_n(&trace_broken, __ATOMIC_ACQUIRE))
+    return;
+
+  collectTrace();
+
+  if (file == NULL)
+    fprintf(out, "\n");
+
+  fprintf(out, "# Breach #\n");
+  fprintf(out, "Thread: %u CPU: %u Cycle: %llu\n", breach.id, breach.cpu, breach.cycle);
+  fprintf(out, "Latency: %lld ns (Threshold: %llu ns)\n", breach.latency, trace_threshold);
+  fprintf(out, "Time: %lld.%09lld\n", breach.timestamp / (s64_t)NSEC_PER_SEC, breach.timestamp % (s64_t)NSEC_PER_SEC);
+  fprintf(out, "Tracing: %s\n", (tracing_on_fd >= 0) ? "stopped" : "not available");
+
+  /* Only the interrupts that fired between the last report (or the start) and the stop. */
+  fprintf(out, "# Interrupts Around Breach #\n");
+  fprintf(out, "Window: %.3f ms before to %.3f ms after\n",
+          (f64_t)(breach.timestamp - recent->time) / NSEC_PER_MSEC,
+          (f64_t)(breach_snapshot.time - breach.timestamp) / NSEC_PER_MSEC);
+
+  for (; cur < data_end; cur = end + 1)
+  {
+    if ((end = memchr(cur, '\n', (size_t)(data_end - cur))) == NULL)
+      end = data_end;
+
+    sum = parseInterrupts(cur, end, &label, &description);
+    if (label == 0u)
+      continue;
+
+    while (*cur == ' ')
+      cur++;
+
+    start = findInterrupts(recent, cur, label);
+    if (sum > start)
+      fprintf(out, "%.*s: %llu %.*s\n", (int)label, cur, sum - start, (int)(end - description), description);
+  }
+}
+
+void closeTrace(void)
+{
+  if (marker_fd >= 0)
+    close(marker_fd);
+
+  if (tracing_on_fd >= 0)
+    close(tracing_on_fd);
+
+  if (interrupts_fd >= 0)
+    close(interrupts_fd);
+
+  marker_fd = tracing_on_fd = interrupts_fd = -1;
+}
@@ -0,0 +1,83 @@
+/**
+  * @file sched_trace.h
+  * @brief Contains the declarations of functions defined in sched_trace.c.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+#ifndef SCHED_TRACE_H
+#define SCHED_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************** Inclusions *********************************/
+
+#include <stdio.h>
+
+#include "data_types.h"
+
+/***************************** Public Functions ******************************/
+
+/**
+  * @brief Prepare the latency breach.
+  * @details Opens the ftrace files and takes the first snapshot of the
+  *          interrupts the breach is compared against. Should be called before
+  *          the threads start. Without ftrace only the context is recorded.
+  * @param threshold The latency that breaks the trace in nsec.
+  * @return TRUE if ftrace can be stopped, FALSE otherwise.
+  */
+u8_t initTrace(u64_t threshold);
+
+/**
+  * @brief Take a snapshot of the interrupts, for the breach to be compared against.
+  * @details Reads /proc/interrupts, so it should only be called by a non-RT
+  *          thread (e.g. on every report). Does nothing once the trace is broken.
+  * @return Void.
+  */
+void sampleTrace(void);
+
+/**
+  * @brief Break the trace once a latency exceeds the threshold.
+  * @details Only the first breach (of any thread) writes a marker,
+  *          stops ftrace and records its context, so that the kernel
+  *          trace ends with the cause of the outlier. The interrupts are
+  *          left to collectTrace(), so that the RT thread reads no file.
+  * @param id The index of the thread.
+  * @param cpu The CPU of the thread.
+  * @param cycle The index of the cycle.
+  * @param latency The latency that exceeded the threshold in nsec.
+  * @param timestamp The time of the cycle in nsec.
+  * @return Void.
+  */
+void breakTrace(u32_t id, u32_t cpu, u64_t cycle, s64_t latency, s64_t timestamp);
+
+/**
+  * @brief Take the snapshot of the interrupts after the breach (if any).
+  * @details Should be called by a non-RT thread once the run has stopped.
+  * @return Void.
+  */
+void collectTrace(void);
+
+/**
+  * @brief Print the context of the breach (if any) to file/console.
+  * @param file The file to print to. Print to console if NULL.
+  * @return Void.
+  */
+void printTrace(FILE* file);
+
+/**
+  * @brief Close the ftrace files.
+  * @return Void.
+  */
+void closeTrace(void);
+
+/*****************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* SCHED_TRACE_H */
@@ -0,0 +1,96 @@
+/**
+  * @file sched_workload.c
+  * @brief Implements the synthetic work of each cycle, a calibrated spin
+  *        and a working set, so that the latency is measured next to computation.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+/******************************** Inclusions *********************************/
+
+#include "sched_workload.h"
+#include "sched_statistics.h"
+#include "sched_clock.h"
+
+/***************************** Macro Definitions *****************************/
+
+/** The iterations of each calibration run. */
+#define CALIBRATION_SPIN_LOOPS (10000000u)
+
+/** The calibration runs, of which the fastest is kept (the others were disturbed). */
+#define CALIBRATION_SPIN_RUNS (5u)
+
+/***************************** Static Variables ******************************/
+
+/** The spin iterations per nsec. */
+static f64_t spin_rate;
+
+/************************ Static Function Prototypes *************************/
+
+/**
+  * @brief Spin for a number of iterations.
+  * @param loops The number of iterations.
+  * @return Void.
+  */
+static void spin(u64_t loops);
+
+/***************************** Static Functions ******************************/
+
+void spin(u64_t loops)
+{
+  u64_t i;
+
+  /* The barrier keeps the compiler from removing (or merging) the iterations. */
+  for (i = 0u; i < loops; i++)
+    __asm__ __volatile__("" : : : "memory");
+}
+
+/***************************** Public Functions ******************************/
+
+void calibrateWorkload(void)
+{
+  s64_t before, elapsed, fastest = S64_MAX;
+  u32_t i;
+
+  for (i = 0u; i < CALIBRATION_SPIN_RUNS; i++)
+  {
+    before = getClockNsec();
+    spin(CALIBRATION_SPIN_LOOPS);
+    elapsed = getClockNsec() - before;
+
+    if ((elapsed > 0) && (elapsed < fastest))
+      fastest = elapsed;
+  }
+
+  spin_rate = (f64_t)CALIBRATION_SPIN_LOOPS / (f64_t)fastest;
+}
+
+void initWorkload(workload_t* workload, u64_t spin_nsec, u8_t* working_set, u64_t working_set_size)
+{
+  workload->spin_loops = (u64_t)((f64_t)spin_nsec * spin_rate);
+  workload->working_set = working_set;
+  workload->working_set_size = (working_set != NULL) ? working_set_size : 0u;
+}
+
+u8_t hasWorkload(const workload_t* workload)
+{
+  return ((workload->spin_loops > 0u) || (workload->working_set_size > 0u)) ? TRUE : FALSE;
+}
+
+void runWorkload(const workload_t* workload)
+{
+  volatile u8_t* line = workload->working_set;
+  u64_t i;
+
+  /* Dirty every cache line, so that the working set is written back as well. */
+  for (i = 0u; i < workload->working_set_size; i += CACHE_LINE_SIZE)
+    line[i]++;
+
+  spin(workload->spin_loops);
+}
+
+f64_t getSpinRate(void)
+{
+  return spin_rate * NSEC_PER_USEC;
+}
@@ -0,0 +1,77 @@
+/**
+  * @file sched_workload.h
+  * @brief Contains the declarations of functions defined in sched_workload.c.
+  *
+  * @author Dimitrios Panagiotis G. Geromichalos (geromidg@gmai.com)
+  * @date August, 2017
+  */
+
+#ifndef SCHED_WORKLOAD_H
+#define SCHED_WORKLOAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************** Inclusions *********************************/
+
+#include "data_types.h"
+
+/***************************** Type Definitions ******************************/
+
+/** The synthetic work of each cycle of a measurement thread. */
+typedef struct
+{
+  u64_t spin_loops;        /**< The iterations of the calibrated spin. */
+  u8_t* working_set;       /**< The memory touched every cycle (NULL for none). */
+  u64_t working_set_size;  /**< The size of the working set in bytes. */
+} workload_t;
+
+/***************************** Public Functions ******************************/
+
+/**
+  * @brief Measure how fast the spin of the workload runs on this CPU.
+  * @details Should be called once before the threads start, and before
+  *          any workload is initialized. The spin is then a fixed amount
+  *          of work, i.e. time spent preempted does not count towards it.
+  * @return Void.
+  */
+void calibrateWorkload(void);
+
+/**
+  * @brief Initialize the workload of a measurement thread.
+  * @param workload The workload to initialize.
+  * @param spin The duration of the spin in nsec (as calibrated).
+  * @param working_set The memory touched every cycle (prefaulted, NULL for none).
+  * @param working_set_size The size of the working set in bytes.
+  * @return Void.
+  */
+void initWorkload(workload_t* workload, u64_t spin, u8_t* working_set, u64_t working_set_size);
+
+/**
+  * @brief Check whether a workload does any work.
+  * @param workload The workload to check.
+  * @return TRUE if the workload spins or touches memory.
+  */
+u8_t hasWorkload(const workload_t* workload);
+
+/**
+  * @brief Run the work of a cycle: touch every cache line of the working set, then spin.
+  * @param workload The workload to run.
+  * @return Void.
+  */
+void runWorkload(const workload_t* workload);
+
+/**
+  * @brief Get the calibrated speed of the spin.
+  * @return The spin iterations per usec.
+  */
+f64_t getSpinRate(void);
+
+/*****************************************************************************/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* SCHED_WORKLOAD_H */